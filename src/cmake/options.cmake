@@ -1,6 +1,8 @@
 # build project generation options
 set(BNG_BUILD_TESTS TRUE CACHE BOOL "add tests suites to project")
+set(BNG_SOLVE_STATS FALSE CACHE BOOL "count culled words, candidates and compared pairs in cull and solve (letterboxed --stats)")
 set(BNG_USE_FOLDERS TRUE CACHE BOOL "use folders in IDE organization")
+set(BNG_EMBED_WORD_DB TRUE CACHE BOOL "preprocess words_alpha.txt at build time and compile it into letterboxed")
 
 set(BNG_OPTIMIZED_BUILD_TYPE BNG_DEBUG CACHE STRING "what it says on the tin")
 set_property(CACHE BNG_OPTIMIZED_BUILD_TYPE PROPERTY STRINGS BNG_DEBUG BNG_RELEASE)
@@ -7,9 +7,12 @@
 #include <string.h>
 #include <float.h>
 #include <assert.h>
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <array>
+#include <bit>
+#include <type_traits>
 #include <filesystem>
 
 #if defined(BNG_IS_WINDOWS)
@@ -49,13 +52,13 @@ inline bool fopen_s(FILE** pfp, const char* path, const char* mode) {
 
 #define BNG_IMPL_MOVE(CLASS) \
   CLASS(CLASS&& rhs) noexcept { \
-    memcpy(this, &rhs, sizeof(*this)); \
-    memset(&rhs, 0, sizeof(*this)); \
+    memcpy((void*)this, (const void*)&rhs, sizeof(*this)); \
+    memset((void*)&rhs, 0, sizeof(*this)); \
   }; \
   CLASS& operator =(CLASS&& rhs) noexcept { \
     this->~CLASS(); \
-    memcpy(this, &rhs, sizeof(*this)); \
-    memset(&rhs, 0, sizeof(*this)); \
+    memcpy((void*)this, (const void*)&rhs, sizeof(*this)); \
+    memset((void*)&rhs, 0, sizeof(*this)); \
     return *this; \
   }
 
@@ -123,6 +126,190 @@ namespace bng::core {
   }
   using clock = std::chrono::steady_clock;
 
+  // chrome trace json (chrome://tracing, ui.perfetto.dev) of named scopes on every thread.
+  // off until trace::start(). each thread records into its own fixed size ring, so recording
+  // takes no locks. a full ring overwrites its oldest events.
+  namespace trace {
+    struct Event {
+      // not copied. string literals.
+      const char* name = nullptr;
+      // since trace::start().
+      uint64_t time_ns = 0;
+      bool is_begin = false;
+    };
+
+    struct ThreadRing {
+      static constexpr uint32_t kCapacity = 1u << 15;
+
+      Event events[kCapacity];
+      // events ever recorded. only the owning thread adds to it.
+      std::atomic<uint64_t> count = 0;
+      std::atomic<bool> is_owned = false;
+      // chrome trace tid. one row in the timeline per ring.
+      uint32_t tid = 0;
+      ThreadRing* next = nullptr;
+    };
+
+    namespace dtl {
+      inline std::atomic<bool> is_enabled = false;
+      // rings are pushed on the front and never freed.
+      inline std::atomic<ThreadRing*> rings = nullptr;
+      inline std::atomic<uint32_t> ring_count = 0;
+      inline clock::time_point start_time = clock::now();
+      inline char exit_path[1024] = {};
+
+      // a thread that exits gives its ring back, so short lived workers reuse a few rings.
+      struct RingOwner {
+        ThreadRing* ring = nullptr;
+
+        ~RingOwner() {
+          if (ring) {
+            ring->is_owned.store(false, std::memory_order_release);
+          }
+        }
+      };
+
+      inline ThreadRing* acquire_ring() {
+        for (auto r = rings.load(std::memory_order_acquire); r; r = r->next) {
+          bool is_owned = false;
+          if (r->is_owned.compare_exchange_strong(is_owned, true, std::memory_order_acq_rel)) {
+            return r;
+          }
+        }
+        auto r = new ThreadRing;
+        r->is_owned.store(true, std::memory_order_relaxed);
+        r->tid = ring_count.fetch_add(1, std::memory_order_relaxed) + 1;
+        r->next = rings.load(std::memory_order_relaxed);
+        while (!rings.compare_exchange_weak(r->next, r, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+        return r;
+      }
+
+      inline void record(const char* name, bool is_begin) {
+        thread_local RingOwner owner;
+        if (!owner.ring) {
+          owner.ring = acquire_ring();
+        }
+        auto& ring = *owner.ring;
+        const uint64_t n = ring.count.load(std::memory_order_relaxed);
+        const auto time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start_time).count();
+        ring.events[n & (ThreadRing::kCapacity - 1)] = Event{ name, uint64_t(time_ns), is_begin };
+        ring.count.store(n + 1, std::memory_order_release);
+      }
+
+      inline void write_json_str(FILE* fp, const char* str) {
+        fputc('"', fp);
+        for (const char* p = str ? str : ""; *p; ++p) {
+          if (*p == '"' || *p == '\\') {
+            fputc('\\', fp);
+          }
+          fputc(uint8_t(*p) < 0x20 ? ' ' : *p, fp);
+        }
+        fputc('"', fp);
+      }
+    }
+
+    inline bool is_enabled() {
+      return dtl::is_enabled.load(std::memory_order_relaxed);
+    }
+
+    inline void begin(const char* name) {
+      if (is_enabled()) {
+        dtl::record(name, true);
+      }
+    }
+
+    inline void end(const char* name) {
+      if (is_enabled()) {
+        dtl::record(name, false);
+      }
+    }
+
+    // drops every recorded event. no thread may be recording.
+    inline void clear() {
+      for (auto r = dtl::rings.load(std::memory_order_acquire); r; r = r->next) {
+        r->count.store(0, std::memory_order_relaxed);
+      }
+    }
+
+    // every event still in a ring. threads that may still be recording should be idle,
+    // or their newest events can be torn.
+    inline bool write(const char* path) {
+      FILE* fp = nullptr;
+      if (path) {
+        fopen_s(&fp, path, "w");
+      }
+      if (!fp) {
+        return false;
+      }
+      fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", fp);
+      bool is_first = true;
+      for (auto r = dtl::rings.load(std::memory_order_acquire); r; r = r->next) {
+        const uint64_t count = r->count.load(std::memory_order_acquire);
+        const uint64_t first = count > ThreadRing::kCapacity ? count - ThreadRing::kCapacity : 0;
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+          is_first ? "" : ",\n", r->tid, r->tid);
+        is_first = false;
+        for (uint64_t i = first; i < count; ++i) {
+          const auto& e = r->events[i & (ThreadRing::kCapacity - 1)];
+          fputs(",\n{\"name\":", fp);
+          dtl::write_json_str(fp, e.name);
+          fprintf(fp, ",\"ph\":\"%c\",\"ts\":%llu.%03u,\"pid\":1,\"tid\":%u}",
+            e.is_begin ? 'B' : 'E', (unsigned long long)(e.time_ns / 1000), uint32_t(e.time_ns % 1000), r->tid);
+        }
+      }
+      fputs("\n]}\n", fp);
+      fclose(fp);
+      return true;
+    }
+
+    // starts recording, with times from now. call before other threads record.
+    // exit_path, when not null, is written with write() when the process exits.
+    inline void start(const char* exit_path = nullptr) {
+      dtl::start_time = clock::now();
+      if (exit_path) {
+        static bool is_registered = false;
+        snprintf(dtl::exit_path, sizeof(dtl::exit_path), "%s", exit_path);
+        if (!is_registered) {
+          is_registered = true;
+          atexit([]() { write(dtl::exit_path); });
+        }
+      }
+      dtl::is_enabled.store(true, std::memory_order_release);
+    }
+
+    inline void stop() {
+      dtl::is_enabled.store(false, std::memory_order_release);
+    }
+
+    // begin on construction and end on destruction, if tracing was on at construction.
+    class Scope {
+    public:
+      BNG_DECL_NO_COPY_IMPL_MOVE(Scope);
+
+      explicit Scope(const char* name)
+        : name(is_enabled() ? name : nullptr)
+      {
+        if (this->name) {
+          dtl::record(this->name, true);
+        }
+      }
+
+      ~Scope() {
+        if (name) {
+          dtl::record(name, false);
+          name = nullptr;
+        }
+      }
+
+    private:
+      const char* name = nullptr;
+    };
+  }
+
+#define BNG_TRACE_SCOPE(NAME) \
+  bng::core::trace::Scope(NAME)
+
   class ScopedTimer {
   public:
     BNG_DECL_NO_COPY_IMPL_MOVE(ScopedTimer);
@@ -133,12 +320,20 @@ namespace bng::core {
       : start(clock::now()), elapsed_out(elapsed_out), units(units) 
     {}
 
+    // also a trace scope named msg when tracing is on.
     ScopedTimer(const char* file, uint32_t line, const char* msg, Units units = Units::ms)
-      : start(clock::now()), msg(msg), file(log::basename(file)), units(units), line(line)
+      : start(clock::now()), msg(msg), file(log::basename(file)), units(units), line(line),
+        is_traced(trace::is_enabled())
     {
+      if (is_traced) {
+        trace::dtl::record(msg, true);
+      }
     }
 
     ~ScopedTimer() {
+      if (is_traced) {
+        trace::dtl::record(msg, false);
+      }
       const double elapsed_time = elapsed(units);
       if (elapsed_out) {
         *elapsed_out = elapsed_time;
@@ -198,6 +393,7 @@ namespace bng::core {
     double* elapsed_out = nullptr;
     Units units = Units::ms;
     uint32_t line = 0;
+    bool is_traced = false;
   };
 
 #define BNG_SCOPED_TIMER(MSG, ...) \
@@ -207,17 +403,35 @@ namespace bng::core {
     BNG_DECL_NO_COPY_IMPL_MOVE(File);
     FILE* fp = nullptr;
 
+    File() = default;
+
     explicit File(const char* path, const char* mode) {
       fopen_s(&fp, path, mode);
     }
 
+    // a new binary file opened for update, removed when it is closed.
+    static File temp() {
+      File file;
+#if defined(BNG_IS_WINDOWS)
+      tmpfile_s(&file.fp);
+#else
+      file.fp = tmpfile();
+#endif
+      return file;
+    }
+
     operator FILE* () { return fp; }
     operator bool() const { return !!fp; }
     bool operator!() const { return !fp; }
 
-    uint32_t size_bytes() {
-      fseek(fp, 0, SEEK_END);
-      auto sz = uint32_t(ftell(fp));
+    uint64_t size_bytes() {
+#if defined(BNG_IS_WINDOWS)
+      _fseeki64(fp, 0, SEEK_END);
+      auto sz = uint64_t(_ftelli64(fp));
+#else
+      fseeko(fp, 0, SEEK_END);
+      auto sz = uint64_t(ftello(fp));
+#endif
       rewind(fp);
       return sz;
     }
@@ -233,10 +447,34 @@ namespace bng::core {
   template<typename N>
   inline uint32_t count_bits(N bits) {
     static_assert(std::numeric_limits<N>::is_integer);
-    uint32_t c = 0;
-    for (; bits; ++c, bits &= (bits - 1))
-      ;
-    return c;
+    return uint32_t(std::popcount(std::make_unsigned_t<N>(bits)));
+  }
+
+  // fast non-cryptographic 64 bit hash for checksums and fingerprints.
+  // 4 independent lanes so the multiplies overlap.
+  inline uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0) {
+    constexpr uint64_t kMul = 0x9e3779b97f4a7c15ull;
+    auto mix = [](uint64_t h, uint64_t v) {
+      h = (h ^ v) * kMul;
+      return h ^ (h >> 29);
+    };
+    const auto p = static_cast<const uint8_t*>(data);
+    uint64_t lanes[4] = { seed, seed + 1, seed + 2, seed + 3 };
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+      uint64_t v[4];
+      memcpy(v, p + i, sizeof(v));
+      for (uint32_t l = 0; l < 4; ++l) {
+        lanes[l] = mix(lanes[l], v[l]);
+      }
+    }
+    uint64_t h = mix(mix(mix(mix(uint64_t(size), lanes[0]), lanes[1]), lanes[2]), lanes[3]);
+    for (; i < size; i += 8) {
+      uint64_t v = 0;
+      memcpy(&v, p + i, (size - i) < 8 ? (size - i) : 8);
+      h = mix(h, v);
+    }
+    return mix(h, 0);
   }
 } // namespace bng
 
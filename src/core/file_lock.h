@@ -0,0 +1,84 @@
+#pragma once
+#include "core/core.h"
+
+#if defined(BNG_IS_WINDOWS)
+# if !defined(WIN32_LEAN_AND_MEAN)
+#   define WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+#else
+# include <errno.h>
+# include <fcntl.h>
+# include <sys/file.h>
+#endif
+
+namespace bng::core {
+  // exclusive lock between processes on a lock file, held until destroyed. waits for the
+  // lock to be free. the file is created if it doesn't exist and left in place. the lock is
+  // on its own file, so the file it guards can still be written through any handle.
+  // false if the lock file can't be opened, e.g. in a read only directory.
+  class FileLock {
+  public:
+    BNG_DECL_NO_COPY(FileLock);
+
+    explicit FileLock(const char* path) {
+#if defined(BNG_IS_WINDOWS)
+      HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+      if (file == INVALID_HANDLE_VALUE) {
+        return;
+      }
+      OVERLAPPED overlapped = {};
+      if (!LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped)) {
+        CloseHandle(file);
+        return;
+      }
+      _file = file;
+#else
+      const int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+      if (fd < 0) {
+        return;
+      }
+      int result = 0;
+      while ((result = flock(fd, LOCK_EX)) && errno == EINTR) {
+      }
+      if (result) {
+        close(fd);
+        return;
+      }
+      _fd = fd;
+#endif
+    }
+
+    ~FileLock() {
+#if defined(BNG_IS_WINDOWS)
+      if (_file) {
+        OVERLAPPED overlapped = {};
+        UnlockFileEx(_file, 0, 1, 0, &overlapped);
+        CloseHandle(_file);
+      }
+      _file = nullptr;
+#else
+      // closing the last descriptor of the file releases the lock.
+      if (_fd >= 0) {
+        close(_fd);
+      }
+      _fd = -1;
+#endif
+    }
+
+#if defined(BNG_IS_WINDOWS)
+    operator bool() const { return !!_file; }
+#else
+    operator bool() const { return _fd >= 0; }
+#endif
+    bool operator!() const { return !bool(*this); }
+
+  private:
+#if defined(BNG_IS_WINDOWS)
+    HANDLE _file = nullptr;
+#else
+    int _fd = -1;
+#endif
+  };
+} // namespace bng::core
@@ -0,0 +1,88 @@
+#pragma once
+#include "core/core.h"
+
+#if defined(BNG_IS_WINDOWS)
+# if !defined(WIN32_LEAN_AND_MEAN)
+#   define WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+namespace bng::core {
+  // whole file mapped into memory. pages are copy on write, so the contents
+  // can be patched in memory without changing the file.
+  class MappedFile {
+  public:
+    BNG_DECL_NO_COPY_IMPL_MOVE(MappedFile);
+
+    MappedFile() = default;
+
+    explicit MappedFile(const char* path) {
+#if defined(BNG_IS_WINDOWS)
+      HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+      if (file == INVALID_HANDLE_VALUE) {
+        return;
+      }
+      LARGE_INTEGER file_size = {};
+      if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+        _mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        if (_mapping) {
+          _data = static_cast<uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_COPY, 0, 0, 0));
+          _size = _data ? uint64_t(file_size.QuadPart) : 0;
+        }
+      }
+      CloseHandle(file);
+#else
+      const int fd = open(path, O_RDONLY);
+      if (fd < 0) {
+        return;
+      }
+      struct stat st = {};
+      if (!fstat(fd, &st) && st.st_size > 0) {
+        void* p = mmap(nullptr, size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+          _data = static_cast<uint8_t*>(p);
+          _size = uint64_t(st.st_size);
+        }
+      }
+      close(fd);
+#endif
+    }
+
+    ~MappedFile() {
+#if defined(BNG_IS_WINDOWS)
+      if (_data) {
+        UnmapViewOfFile(_data);
+      }
+      if (_mapping) {
+        CloseHandle(_mapping);
+      }
+      _mapping = nullptr;
+#else
+      if (_data) {
+        munmap(_data, size_t(_size));
+      }
+#endif
+      _data = nullptr;
+      _size = 0;
+    }
+
+    operator bool() const { return !!_data; }
+    bool operator!() const { return !_data; }
+
+    uint8_t* data() { return _data; }
+    const uint8_t* data() const { return _data; }
+    uint64_t size() const { return _size; }
+
+  private:
+    uint8_t* _data = nullptr;
+    uint64_t _size = 0;
+#if defined(BNG_IS_WINDOWS)
+    HANDLE _mapping = nullptr;
+#endif
+  };
+} // namespace bng::core
@@ -0,0 +1,96 @@
+#pragma once
+#include "core/core.h"
+
+#if defined(BNG_IS_WINDOWS)
+# include <malloc.h>
+#else
+# include <sys/mman.h>
+#endif
+
+namespace bng::core {
+  // zeroed memory in one cache line aligned allocation. with huge pages a buffer of at least
+  // one huge page is mapped on huge page boundaries and marked for transparent huge pages,
+  // so it is covered by a few TLB entries. smaller buffers would only pay for zeroing a whole
+  // huge page. huge pages are a hint. where they are not supported the buffer is still
+  // allocated, on normal pages.
+  class PageBuf {
+  public:
+    BNG_DECL_NO_COPY_IMPL_MOVE(PageBuf);
+
+    static constexpr uint64_t kAlign = 64;
+    static constexpr uint64_t kHugePageSize = 2ull << 20;
+
+    PageBuf() = default;
+
+    explicit PageBuf(uint64_t size, bool use_huge_pages = false) {
+      if (!size) {
+        return;
+      }
+#if !defined(BNG_IS_WINDOWS)
+      if (use_huge_pages && size >= kHugePageSize) {
+        // over map by a huge page so the start can be aligned, then give back the slack.
+        const uint64_t mapped_size = (size + kHugePageSize - 1) & ~(kHugePageSize - 1);
+        void* p = mmap(nullptr, size_t(mapped_size + kHugePageSize), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED) {
+          auto base = static_cast<uint8_t*>(p);
+          auto aligned = reinterpret_cast<uint8_t*>((uintptr_t(base) + kHugePageSize - 1) & ~uintptr_t(kHugePageSize - 1));
+          if (aligned != base) {
+            munmap(base, size_t(aligned - base));
+          }
+          if (const uint64_t tail = kHugePageSize - uint64_t(aligned - base)) {
+            munmap(aligned + mapped_size, size_t(tail));
+          }
+#if defined(MADV_HUGEPAGE)
+          madvise(aligned, size_t(mapped_size), MADV_HUGEPAGE);
+#endif
+          _data = aligned;
+          _size = size;
+          _mapped_size = mapped_size;
+          return;
+        }
+      }
+      const uint64_t alloc_size = (size + kAlign - 1) & ~(kAlign - 1);
+      _data = static_cast<uint8_t*>(aligned_alloc(size_t(kAlign), size_t(alloc_size)));
+#else
+      (void)use_huge_pages;
+      _data = static_cast<uint8_t*>(_aligned_malloc(size_t(size), size_t(kAlign)));
+#endif
+      BNG_VERIFY(_data, "out of memory");
+      if (_data) {
+        memset(_data, 0, size_t(size));
+        _size = size;
+      }
+    }
+
+    ~PageBuf() {
+#if defined(BNG_IS_WINDOWS)
+      _aligned_free(_data);
+#else
+      if (_mapped_size) {
+        munmap(_data, size_t(_mapped_size));
+      }
+      else {
+        free(_data);
+      }
+#endif
+      _data = nullptr;
+      _size = _mapped_size = 0;
+    }
+
+    operator bool() const { return !!_data; }
+    bool operator!() const { return !_data; }
+
+    uint8_t* data() { return _data; }
+    const uint8_t* data() const { return _data; }
+    uint64_t size() const { return _size; }
+
+    // mapped on huge page boundaries. the os decides whether huge pages back it.
+    bool is_huge_page_aligned() const { return !!_mapped_size; }
+
+  private:
+    uint8_t* _data = nullptr;
+    uint64_t _size = 0;
+    // huge page mappings only.
+    uint64_t _mapped_size = 0;
+  };
+} // namespace bng::core
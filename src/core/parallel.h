@@ -0,0 +1,49 @@
+#pragma once
+#include "core/core.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace bng::core {
+  // 0 means use all hardware threads.
+  inline uint32_t resolve_thread_count(uint32_t thread_count) {
+    if (!thread_count) {
+      thread_count = std::thread::hardware_concurrency();
+    }
+    return thread_count ? thread_count : 1;
+  }
+
+  // calls fn(worker_i, chunk_i) for every chunk_i in [0, chunk_count).
+  // workers claim the next unprocessed chunk as soon as they finish one,
+  // so many small chunks balance uneven work across threads.
+  // the calling thread is worker 0. worker_i < thread_count.
+  template<typename F>
+  void parallel_for_chunks(uint32_t chunk_count, uint32_t thread_count, F&& fn) {
+    thread_count = std::min(resolve_thread_count(thread_count), chunk_count);
+    if (thread_count <= 1) {
+      for (uint32_t ci = 0; ci < chunk_count; ++ci) {
+        fn(0u, ci);
+      }
+      return;
+    }
+
+    std::atomic<uint32_t> next_chunk = 0;
+    auto worker = [&](uint32_t worker_i) {
+      auto _trace = BNG_TRACE_SCOPE("parallel_for_chunks worker");
+      for (uint32_t ci; (ci = next_chunk.fetch_add(1, std::memory_order_relaxed)) < chunk_count; ) {
+        fn(worker_i, ci);
+      }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (uint32_t wi = 1; wi < thread_count; ++wi) {
+      threads.emplace_back(worker, wi);
+    }
+    worker(0);
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+} // namespace bng::core
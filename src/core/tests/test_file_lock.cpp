@@ -0,0 +1,35 @@
+#include "core.h"
+#include "file_lock.h"
+#include "test_harness/test_harness.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+using namespace bng::core;
+
+BNG_TEST(file_lock_exclusive, {
+	const char* path = "test_file_lock.lock";
+	auto lock = std::make_unique<FileLock>(path);
+	BT_CHECK(*lock);
+
+	// a second lock of the file, even from the same process, waits for the first.
+	std::atomic<bool> is_other_locked = false;
+	std::thread other([&]() {
+		FileLock other_lock(path);
+		is_other_locked = bool(other_lock);
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	BT_CHECK(!is_other_locked);
+	lock.reset();
+	other.join();
+	BT_CHECK(is_other_locked);
+
+	FileLock relocked(path);
+	BT_CHECK(relocked);
+
+	// no lock without a lock file.
+	FileLock missing("no_such_dir/test_file_lock.lock");
+	BT_CHECK(!missing);
+	remove(path);
+});
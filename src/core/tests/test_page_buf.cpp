@@ -0,0 +1,39 @@
+#include "core.h"
+#include "page_buf.h"
+#include "test_harness/test_harness.h"
+
+using namespace bng::core;
+
+static bool is_zeroed(const PageBuf& buf) {
+	for (uint64_t i = 0; i < buf.size(); ++i) {
+		if (buf.data()[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+BNG_TEST(page_buf_alloc, {
+	PageBuf empty(0);
+	BT_CHECK(!empty && empty.size() == 0);
+
+	// smaller than a huge page stays on normal pages even when huge pages are asked for.
+	PageBuf small(1000, true);
+	BT_CHECK(small && small.size() == 1000 && !small.is_huge_page_aligned());
+	BT_CHECK(!(uintptr_t(small.data()) & (PageBuf::kAlign - 1)));
+	BT_CHECK(is_zeroed(small));
+
+	const uint64_t large_size = PageBuf::kHugePageSize * 2 + 100;
+	PageBuf large(large_size, true);
+	BT_CHECK(large && large.size() == large_size);
+	BT_CHECK(is_zeroed(large));
+#if !defined(BNG_IS_WINDOWS)
+	BT_CHECK(large.is_huge_page_aligned());
+	BT_CHECK(!(uintptr_t(large.data()) & (PageBuf::kHugePageSize - 1)));
+#endif
+	memset(large.data(), 0xab, size_t(large_size));
+	BT_CHECK(large.data()[large_size - 1] == 0xab);
+
+	PageBuf moved = std::move(large);
+	BT_CHECK(!large && moved.size() == large_size && moved.data()[0] == 0xab);
+});
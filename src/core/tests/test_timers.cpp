@@ -0,0 +1,93 @@
+#include "core.h"
+#include "parallel.h"
+#include "timers.h"
+#include "test_harness/test_harness.h"
+#include <string.h>
+
+using namespace bng::core;
+
+static const timers::PhaseStats* find_phase(const std::vector<timers::PhaseStats>& stats, const char* name, uint32_t depth) {
+	for (const auto& ps : stats) {
+		if (!strcmp(ps.name, name) && ps.depth == depth) {
+			return &ps;
+		}
+	}
+	return nullptr;
+}
+
+BNG_TEST(timers_histogram, {
+	using Histogram = timers::Histogram;
+	// buckets are contiguous and each one starts at the first ns that maps to it.
+	for (uint32_t b = 0; b + 1 < Histogram::kBucketCount; ++b) {
+		BT_CHECK(Histogram::bucket_of(Histogram::bucket_low(b)) == b);
+		BT_CHECK(Histogram::bucket_of(Histogram::bucket_low(b + 1) - 1) == b);
+	}
+	BT_CHECK(Histogram::bucket_of(~0ull) == Histogram::kBucketCount - 1);
+
+	auto h = std::make_unique<Histogram>();
+	BT_CHECK(h->percentile_ns(0.5) == 0);
+	for (uint64_t ns = 1; ns <= 1000; ++ns) {
+		h->add(ns * 1000);
+	}
+	BT_CHECK(h->count == 1000 && h->total_ns == 500500000 && h->max_ns == 1000000);
+	// within a bucket width of the exact percentiles.
+	const auto near = [](uint64_t ns, uint64_t expected) {
+		return ns >= expected * 3 / 4 && ns <= expected * 5 / 4;
+	};
+	BT_CHECK(near(h->percentile_ns(0.5), 500000));
+	BT_CHECK(near(h->percentile_ns(0.95), 950000));
+	BT_CHECK(near(h->percentile_ns(0.99), 990000));
+	BT_CHECK(h->percentile_ns(1.0) == 1000000);
+
+	auto merged = std::make_unique<Histogram>();
+	merged->merge(*h);
+	merged->merge(*h);
+	BT_CHECK(merged->count == 2000 && merged->max_ns == 1000000);
+	BT_CHECK(merged->percentile_ns(0.5) == h->percentile_ns(0.5));
+});
+
+BNG_TEST(timers_phases, {
+	// nothing is timed before start.
+	{
+		auto _timer = BNG_TIMED_SCOPE("before start");
+	}
+	timers::start();
+	for (uint32_t i = 0; i < 3; ++i) {
+		auto _outer = BNG_TIMED_SCOPE("outer");
+		auto _inner = BNG_TIMED_SCOPE("inner");
+		timers::record("recorded", 5000000);
+	}
+	{
+		auto _inner = BNG_TIMED_SCOPE("inner");
+	}
+	parallel_for_chunks(64, 4, [](uint32_t, uint32_t) {
+		auto _timer = BNG_TIMED_SCOPE("chunk");
+	});
+	timers::stop();
+	{
+		auto _timer = BNG_TIMED_SCOPE("after stop");
+	}
+
+	const auto stats = timers::collect();
+	BT_CHECK(!find_phase(stats, "before start", 0) && !find_phase(stats, "after stop", 0));
+	const auto outer = find_phase(stats, "outer", 0);
+	BT_CHECK(outer && outer->count == 3);
+	// the same name under another parent is another phase.
+	const auto nested_inner = find_phase(stats, "inner", 1);
+	const auto top_inner = find_phase(stats, "inner", 0);
+	BT_CHECK(nested_inner && nested_inner->count == 3);
+	BT_CHECK(top_inner && top_inner->count == 1);
+	const auto recorded = find_phase(stats, "recorded", 2);
+	BT_CHECK(recorded && recorded->count == 3 && recorded->total_ms == 15.0 && recorded->max_ms == 5.0);
+	BT_CHECK(recorded->p50_ms > 3.75 && recorded->p99_ms <= 5.0);
+	// summed over the worker threads.
+	const auto chunk = find_phase(stats, "chunk", 0);
+	BT_CHECK(chunk && chunk->count == 64);
+	// children follow their parent.
+	BT_CHECK(outer < nested_inner && nested_inner < recorded);
+	BT_CHECK(outer->total_ms >= nested_inner->total_ms);
+
+	timers::report(stdout);
+	timers::clear();
+	BT_CHECK(find_phase(timers::collect(), "outer", 0)->count == 0);
+});
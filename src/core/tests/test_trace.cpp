@@ -0,0 +1,76 @@
+#include "core.h"
+#include "parallel.h"
+#include "test_harness/test_harness.h"
+#include <string>
+
+using namespace bng::core;
+
+static std::string read_text(const char* path) {
+	std::string text;
+	File file(path, "rb");
+	if (file) {
+		text.resize(size_t(file.size_bytes()));
+		text.resize(fread(text.data(), 1, text.size(), file));
+	}
+	return text;
+}
+
+static uint32_t count_of(const std::string& text, const char* needle) {
+	uint32_t count = 0;
+	for (size_t p = text.find(needle); p != std::string::npos; p = text.find(needle, p + 1)) {
+		++count;
+	}
+	return count;
+}
+
+BNG_TEST(trace_scopes, {
+	// nothing is recorded before start.
+	{
+		auto _trace = BNG_TRACE_SCOPE("before start");
+	}
+	trace::start();
+	{
+		auto _outer = BNG_TRACE_SCOPE("outer");
+		auto _inner = BNG_TRACE_SCOPE("inner \"quoted\"");
+		auto _timer = BNG_SCOPED_TIMER("timed");
+	}
+	parallel_for_chunks(16, 4, [](uint32_t, uint32_t) {
+		auto _trace = BNG_TRACE_SCOPE("chunk");
+	});
+	trace::stop();
+	{
+		auto _trace = BNG_TRACE_SCOPE("after stop");
+	}
+
+	BT_CHECK(trace::write("trace_scopes.json"));
+	const auto text = read_text("trace_scopes.json");
+	BT_CHECK(text.find("\"traceEvents\"") != std::string::npos);
+	BT_CHECK(count_of(text, "before start") == 0 && count_of(text, "after stop") == 0);
+	BT_CHECK(count_of(text, "\"name\":\"outer\"") == 2);
+	BT_CHECK(count_of(text, "\"name\":\"inner \\\"quoted\\\"\"") == 2);
+	BT_CHECK(count_of(text, "\"name\":\"timed\"") == 2);
+	BT_CHECK(count_of(text, "\"name\":\"chunk\"") == 32);
+	BT_CHECK(count_of(text, "\"ph\":\"B\"") == count_of(text, "\"ph\":\"E\""));
+	// the worker threads recorded on rings of their own.
+	BT_CHECK(count_of(text, "\"ph\":\"M\"") > 1);
+	unlink("trace_scopes.json");
+});
+
+BNG_TEST(trace_ring_wrap, {
+	trace::clear();
+	trace::start();
+	const uint32_t scope_count = trace::ThreadRing::kCapacity;
+	for (uint32_t i = 0; i < scope_count; ++i) {
+		auto _trace = BNG_TRACE_SCOPE("wrap");
+	}
+	trace::stop();
+
+	// twice as many events as fit. only the newest ring full is kept.
+	BT_CHECK(trace::write("trace_ring_wrap.json"));
+	const auto text = read_text("trace_ring_wrap.json");
+	BT_CHECK(count_of(text, "\"name\":\"wrap\"") == trace::ThreadRing::kCapacity);
+	BT_CHECK(count_of(text, "\"name\":\"chunk\"") == 0);
+	unlink("trace_ring_wrap.json");
+
+	BT_CHECK(!trace::write(nullptr));
+});
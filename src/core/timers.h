@@ -0,0 +1,331 @@
+#pragma once
+#include "core/core.h"
+#include <mutex>
+#include <vector>
+
+namespace bng::core {
+  // named phase timers collected over a whole run, e.g. every puzzle of a batch.
+  // off until timers::start(). a phase timed inside another is its child, so the same name
+  // under different parents is a different phase. each thread adds to histograms of its
+  // own without locks. report() merges them.
+  namespace timers {
+    // log bucketed ns. 4 buckets per power of two, so a bucket is at most 25% wide.
+    struct Histogram {
+      static constexpr uint32_t kSubBits = 2;
+      static constexpr uint32_t kSubCount = 1u << kSubBits;
+      static constexpr uint32_t kBucketCount = (64 - kSubBits + 1) * kSubCount;
+
+      // only one thread adds, so plain loads and stores are enough. they are atomic
+      // so report() can read while that thread is still timing.
+      std::atomic<uint64_t> count = 0;
+      std::atomic<uint64_t> total_ns = 0;
+      std::atomic<uint64_t> max_ns = 0;
+      std::atomic<uint64_t> buckets[kBucketCount] = {};
+
+      static uint32_t bucket_of(uint64_t ns) {
+        if (ns < kSubCount) {
+          return uint32_t(ns);
+        }
+        const auto log = uint32_t(63 - std::countl_zero(ns));
+        const auto sub = uint32_t(ns >> (log - kSubBits)) & (kSubCount - 1);
+        return (log - kSubBits + 1) * kSubCount + sub;
+      }
+
+      // smallest ns in bucket b.
+      static uint64_t bucket_low(uint32_t b) {
+        if (b < kSubCount) {
+          return b;
+        }
+        const uint32_t log = b / kSubCount + kSubBits - 1;
+        return uint64_t(kSubCount + b % kSubCount) << (log - kSubBits);
+      }
+
+      void add(uint64_t ns) {
+        auto bump = [](std::atomic<uint64_t>& v, uint64_t by) {
+          v.store(v.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+        };
+        bump(count, 1);
+        bump(total_ns, ns);
+        bump(buckets[bucket_of(ns)], 1);
+        if (ns > max_ns.load(std::memory_order_relaxed)) {
+          max_ns.store(ns, std::memory_order_relaxed);
+        }
+      }
+
+      // rhs may still be adding.
+      void merge(const Histogram& rhs) {
+        count.store(count.load(std::memory_order_relaxed) + rhs.count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        total_ns.store(total_ns.load(std::memory_order_relaxed) + rhs.total_ns.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        max_ns.store(std::max(max_ns.load(std::memory_order_relaxed), rhs.max_ns.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+        for (uint32_t b = 0; b < kBucketCount; ++b) {
+          buckets[b].store(buckets[b].load(std::memory_order_relaxed) + rhs.buckets[b].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+      }
+
+      // p in [0, 1]. the middle of the bucket holding the sample of rank p, capped at the max.
+      // the top rank is the max.
+      uint64_t percentile_ns(double p) const {
+        const uint64_t total = count.load(std::memory_order_relaxed);
+        if (!total) {
+          return 0;
+        }
+        const auto rank = std::max(uint64_t(1), uint64_t(p * double(total) + 0.5));
+        if (rank >= total) {
+          return max_ns.load(std::memory_order_relaxed);
+        }
+        uint64_t seen = 0;
+        for (uint32_t b = 0; b < kBucketCount; ++b) {
+          seen += buckets[b].load(std::memory_order_relaxed);
+          if (seen >= rank) {
+            const uint64_t low = bucket_low(b);
+            const uint64_t high = (b + 1 < kBucketCount) ? bucket_low(b + 1) : low;
+            return std::min(low + (high - low) / 2, max_ns.load(std::memory_order_relaxed));
+          }
+        }
+        return max_ns.load(std::memory_order_relaxed);
+      }
+    };
+
+    static constexpr uint32_t kMaxPhases = 256;
+    // phase 0 is the root every top level phase hangs off.
+    static constexpr uint32_t kRootPhase = 0;
+    static constexpr uint32_t kInvalidPhase = ~0u;
+
+    struct PhaseStats {
+      const char* name = nullptr;
+      // 0 for top level phases.
+      uint32_t depth = 0;
+      uint64_t count = 0;
+      double total_ms = 0.0;
+      double mean_ms = 0.0;
+      double p50_ms = 0.0;
+      double p95_ms = 0.0;
+      double p99_ms = 0.0;
+      double max_ms = 0.0;
+    };
+
+    namespace dtl {
+      struct Phase {
+        // not copied. string literals.
+        const char* name = nullptr;
+        uint32_t parent = kInvalidPhase;
+      };
+
+      struct ThreadPhases {
+        static constexpr uint32_t kCacheSize = 64;
+
+        // allocated by the owning thread the first time it times each phase.
+        std::atomic<Histogram*> histograms[kMaxPhases] = {};
+        std::atomic<bool> is_owned = false;
+        ThreadPhases* next = nullptr;
+
+        // owning thread only.
+        // innermost phase being timed.
+        uint32_t current = kRootPhase;
+        // (parent, name) -> phase, so the registry is only locked the first time.
+        struct CacheEntry {
+          const char* name = nullptr;
+          uint32_t parent = kInvalidPhase;
+          uint32_t phase = kInvalidPhase;
+        };
+        CacheEntry cache[kCacheSize];
+      };
+
+      inline std::atomic<bool> is_enabled = false;
+      inline Phase phases[kMaxPhases] = { Phase{ "", kInvalidPhase } };
+      inline std::atomic<uint32_t> phase_count = 1;
+      inline std::mutex phases_mutex;
+      // pushed on the front and never freed.
+      inline std::atomic<ThreadPhases*> threads = nullptr;
+
+      // a thread that exits gives its phases back, so short lived workers don't add up.
+      struct PhasesOwner {
+        ThreadPhases* phases = nullptr;
+
+        ~PhasesOwner() {
+          if (phases) {
+            phases->current = kRootPhase;
+            phases->is_owned.store(false, std::memory_order_release);
+          }
+        }
+      };
+
+      inline ThreadPhases& thread_phases() {
+        thread_local PhasesOwner owner;
+        if (!owner.phases) {
+          for (auto t = threads.load(std::memory_order_acquire); t && !owner.phases; t = t->next) {
+            bool is_owned = false;
+            if (t->is_owned.compare_exchange_strong(is_owned, true, std::memory_order_acq_rel)) {
+              owner.phases = t;
+            }
+          }
+          if (!owner.phases) {
+            auto t = new ThreadPhases;
+            t->is_owned.store(true, std::memory_order_relaxed);
+            t->next = threads.load(std::memory_order_relaxed);
+            while (!threads.compare_exchange_weak(t->next, t, std::memory_order_release, std::memory_order_relaxed)) {
+            }
+            owner.phases = t;
+          }
+        }
+        return *owner.phases;
+      }
+
+      // kInvalidPhase once kMaxPhases are registered.
+      inline uint32_t register_phase(uint32_t parent, const char* name) {
+        std::lock_guard<std::mutex> lock(phases_mutex);
+        const uint32_t count = phase_count.load(std::memory_order_relaxed);
+        for (uint32_t pi = 1; pi < count; ++pi) {
+          if (phases[pi].parent == parent && !strcmp(phases[pi].name, name)) {
+            return pi;
+          }
+        }
+        if (count == kMaxPhases) {
+          return kInvalidPhase;
+        }
+        phases[count] = Phase{ name, parent };
+        phase_count.store(count + 1, std::memory_order_release);
+        return count;
+      }
+
+      inline uint32_t child_phase(ThreadPhases& tp, const char* name) {
+        const uint32_t parent = tp.current;
+        auto& entry = tp.cache[(uint32_t(uintptr_t(name) >> 3) ^ (parent * 0x9e3779b1u)) % ThreadPhases::kCacheSize];
+        if (entry.name != name || entry.parent != parent) {
+          entry = ThreadPhases::CacheEntry{ name, parent, register_phase(parent, name) };
+        }
+        return entry.phase;
+      }
+
+      inline void add(ThreadPhases& tp, uint32_t phase, uint64_t ns) {
+        auto h = tp.histograms[phase].load(std::memory_order_relaxed);
+        if (!h) {
+          h = new Histogram;
+          tp.histograms[phase].store(h, std::memory_order_release);
+        }
+        h->add(ns);
+      }
+    }
+
+    inline bool is_enabled() {
+      return dtl::is_enabled.load(std::memory_order_relaxed);
+    }
+
+    inline void start() {
+      dtl::is_enabled.store(true, std::memory_order_release);
+    }
+
+    inline void stop() {
+      dtl::is_enabled.store(false, std::memory_order_release);
+    }
+
+    // ns for name under the phase being timed on this thread, for times measured elsewhere.
+    inline void record(const char* name, uint64_t ns) {
+      if (!is_enabled()) {
+        return;
+      }
+      auto& tp = dtl::thread_phases();
+      const uint32_t phase = dtl::child_phase(tp, name);
+      if (phase != kInvalidPhase) {
+        dtl::add(tp, phase, ns);
+      }
+    }
+
+    // times the scope as a child of the phase being timed on this thread, if timers
+    // were on at construction.
+    class Scope {
+    public:
+      BNG_DECL_NO_COPY(Scope);
+
+      explicit Scope(const char* name) {
+        if (!is_enabled()) {
+          return;
+        }
+        tp = &dtl::thread_phases();
+        phase = dtl::child_phase(*tp, name);
+        if (phase == kInvalidPhase) {
+          tp = nullptr;
+          return;
+        }
+        parent = tp->current;
+        tp->current = phase;
+        start = clock::now();
+      }
+
+      ~Scope() {
+        if (tp) {
+          const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+          dtl::add(*tp, phase, uint64_t(ns));
+          tp->current = parent;
+        }
+      }
+
+    private:
+      dtl::ThreadPhases* tp = nullptr;
+      uint32_t phase = kInvalidPhase;
+      uint32_t parent = kRootPhase;
+      clock::time_point start;
+    };
+
+    // every phase timed so far merged over all threads, parents before their children.
+    inline std::vector<PhaseStats> collect() {
+      const uint32_t count = dtl::phase_count.load(std::memory_order_acquire);
+      std::vector<PhaseStats> stats;
+      auto visit = [&](auto& self, uint32_t parent, uint32_t depth) -> void {
+        for (uint32_t pi = 1; pi < count; ++pi) {
+          if (dtl::phases[pi].parent != parent) {
+            continue;
+          }
+          auto merged = std::make_unique<Histogram>();
+          for (auto t = dtl::threads.load(std::memory_order_acquire); t; t = t->next) {
+            if (auto h = t->histograms[pi].load(std::memory_order_acquire)) {
+              merged->merge(*h);
+            }
+          }
+          const auto to_ms = [](uint64_t ns) { return double(ns) / 1000000.0; };
+          PhaseStats ps;
+          ps.name = dtl::phases[pi].name;
+          ps.depth = depth;
+          ps.count = merged->count.load(std::memory_order_relaxed);
+          ps.total_ms = to_ms(merged->total_ns.load(std::memory_order_relaxed));
+          ps.mean_ms = ps.count ? ps.total_ms / double(ps.count) : 0.0;
+          ps.p50_ms = to_ms(merged->percentile_ns(0.5));
+          ps.p95_ms = to_ms(merged->percentile_ns(0.95));
+          ps.p99_ms = to_ms(merged->percentile_ns(0.99));
+          ps.max_ms = to_ms(merged->max_ns.load(std::memory_order_relaxed));
+          stats.push_back(ps);
+          self(self, pi, depth + 1);
+        }
+      };
+      visit(visit, kRootPhase, 0);
+      return stats;
+    }
+
+    // one line per phase, children indented under their parent.
+    inline void report(FILE* out = stdout) {
+      fprintf(out, "%-32s %10s %12s %10s %10s %10s %10s %10s\n",
+        "phase", "count", "total ms", "mean ms", "p50 ms", "p95 ms", "p99 ms", "max ms");
+      for (const auto& ps : collect()) {
+        char name[64];
+        snprintf(name, sizeof(name), "%*s%s", int(ps.depth * 2), "", ps.name);
+        fprintf(out, "%-32s %10llu %12.3f %10.4f %10.4f %10.4f %10.4f %10.4f\n",
+          name, (unsigned long long)ps.count, ps.total_ms, ps.mean_ms, ps.p50_ms, ps.p95_ms, ps.p99_ms, ps.max_ms);
+      }
+      fflush(out);
+    }
+
+    // drops every time recorded. phases stay registered. no thread may be timing.
+    inline void clear() {
+      for (auto t = dtl::threads.load(std::memory_order_acquire); t; t = t->next) {
+        for (uint32_t pi = 0; pi < kMaxPhases; ++pi) {
+          if (auto h = t->histograms[pi].exchange(nullptr, std::memory_order_acq_rel)) {
+            delete h;
+          }
+        }
+      }
+    }
+  }
+
+#define BNG_TIMED_SCOPE(NAME) \
+  bng::core::timers::Scope(NAME)
+} // namespace bng::core
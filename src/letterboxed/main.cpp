@@ -1,13 +1,35 @@
 #include "core/core.h"
+#include "core/parallel.h"
+#include "core/timers.h"
+#include "word_db/result_cache.h"
 #include "word_db/word_db.h"
 #include "word_db/word_db_std.h"
+#if defined(BNG_EMBED_WORD_DB)
+# include "word_db_embedded/word_db_embedded.h"
+#endif
+#include <atomic>
+#include <cctype>
+#include <cstdarg>
+#include <string>
+#include <vector>
 
 using namespace bng::core;
 
 namespace orig {
   using namespace bng::word_db;
 
-  WordDB load_word_db() {
+  // the compiled in dictionary unless use_files. otherwise words_alpha.pre,
+  // rebuilt from words_alpha.txt when missing or stale.
+  WordDB load_word_db(bool use_files) {
+#if defined(BNG_EMBED_WORD_DB)
+    if (!use_files) {
+      if (auto embeddedDB = embedded_word_db()) {
+        return embeddedDB;
+      }
+    }
+#else
+    (void)use_files;
+#endif
     WordDB wordDB;
 
     auto txt_name = "words_alpha.txt";
@@ -15,48 +37,367 @@ namespace orig {
 
     if (!wordDB.load(pre_name)) {
       auto _ = BNG_SCOPED_TIMER("proccessed words_alpha.txt -> words_alpha.pre");
-      wordDB.load(txt_name);
+      // one-off, so preprocessing uses all hardware threads.
+      wordDB.load(txt_name, 0);
       wordDB.save(pre_name);
     }
 
     return wordDB;
   }
 
-  WordDB::SideSet init_sides(const char** side_strs) {
-    auto print_err = [&side_strs]() {
-      BNG_PRINT("%s %s %s %s are not 4 sides of 3 unique letters.\n",
-        side_strs[0], side_strs[1], side_strs[2], side_strs[3]);
-      };
+  // results of puzzles solved before, next to the .pre file.
+  const char* const kCacheName = "words_alpha.cache";
 
-    WordDB::SideSet sides;
+  // the solutions of sides from cache, or culled, solved and added to it. either way they
+  // index wordDB's words.
+  template<uint32_t SIDE_COUNT, uint32_t SIDE_WIDTH>
+  SolutionSet solve_cached(ResultCache& cache, const WordDB& wordDB,
+    const BasicSideSet<SIDE_COUNT, SIDE_WIDTH>& sides, uint32_t thread_count, SolveStats* stats)
+  {
+    const auto key = PuzzleKey(sides, wordDB.get_fingerprint());
+    SolutionSet solutions;
+    if (!cache.find(key, solutions)) {
+      const WordDB culledDB = wordDB.culled(sides, stats);
+      solutions = cache.add(key, culledDB, culledDB.solve(sides, thread_count, stats));
+    }
+    return solutions;
+  }
 
-    for (uint32_t si = 0, all_letters = 0; si < 4; ++si) {
+  // false if side_strs are not SIDE_COUNT sides of SIDE_WIDTH unique letters.
+  template<uint32_t SIDE_COUNT, uint32_t SIDE_WIDTH>
+  bool parse_sides(const char* const* side_strs, BasicSideSet<SIDE_COUNT, SIDE_WIDTH>& sides) {
+    for (uint32_t si = 0, all_letters = 0; si < SIDE_COUNT; ++si) {
       auto& s = sides[si];
       auto side_str = side_strs[si];
-      char side_lc[4] = {};
-      if (strlen(side_str) != 3) {
-        print_err();
-        return {};
+      char side_lc[SIDE_WIDTH + 1] = {};
+      if (strlen(side_str) != SIDE_WIDTH) {
+        return false;
       }
-      for (uint32_t i = 0; i < 3; ++i) {
+      for (uint32_t i = 0; i < SIDE_WIDTH; ++i) {
         side_lc[i] = char(tolower(side_str[i]));
         // side has non alpha characters
         if (side_lc[i] < 'a' || side_lc[i] > 'z') {
-          print_err();
-          return {};
+          return false;
         }
       }
       s = Word(side_lc);
-      if ((all_letters & uint32_t(s.letters))) {
-        // sides have overlapping letters
-        print_err();
-        return {};
+      if (s.letter_count != SIDE_WIDTH || (all_letters & uint32_t(s.letters))) {
+        // repeated letters in side or sides have overlapping letters
+        return false;
       }
       all_letters |= uint32_t(s.letters);
     }
+    return true;
+  }
 
+  WordDB::SideSet init_sides(const char** side_strs) {
+    WordDB::SideSet sides;
+    if (!parse_sides(side_strs, sides)) {
+      BNG_PRINT("%s %s %s %s are not 4 sides of 3 unique letters.\n",
+        side_strs[0], side_strs[1], side_strs[2], side_strs[3]);
+      return {};
+    }
     return sides;
   }
+
+  void append_fmt(std::string& out, const char* fmt, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    const int len = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (len > 0) {
+      out.append(buf, std::min(size_t(len), sizeof(buf) - 1));
+    }
+  }
+
+  void print_stats(const SolveStats& stats) {
+    if (!SolveStats::kIsEnabled) {
+      BNG_PUTI("\nstats: not collected. configure with -DBNG_SOLVE_STATS=ON\n");
+      return;
+    }
+    BNG_PRINT("\nstats:\n  cull: %llu words tested  %llu foreign letter rejects  %llu same side rejects\n",
+      (unsigned long long)stats.words_tested, (unsigned long long)stats.foreign_letter_rejects,
+      (unsigned long long)stats.same_side_rejects);
+    BNG_PRINT("  solve: %llu candidateA  %llu pairs compared  %llu hits\n",
+      (unsigned long long)stats.candidates_a, (unsigned long long)stats.pairs_compared,
+      (unsigned long long)stats.hit_count());
+    std::string rows;
+    for (uint32_t li = 0; li < 26; ++li) {
+      if (stats.row_hits[li]) {
+        append_fmt(rows, " %c:%llu", Word::idx_to_letter(li), (unsigned long long)stats.row_hits[li]);
+      }
+    }
+    BNG_PRINT("  hits by candidateB row:%s\n", rows.empty() ? " none" : rows.c_str());
+  }
+
+  // one line per solution. a word with all letter_count puzzle letters is a solution on its own.
+  void append_solutions(std::string& out, const WordDB& wordDB, const SolutionSet& solutions, uint32_t letter_count) {
+    for (auto ps : solutions) {
+      auto& a = *wordDB.word(ps.a);
+      auto& b = *wordDB.word(ps.b);
+      if (a.letter_count == letter_count || b.letter_count == letter_count) {
+        auto& c = (a.letter_count == letter_count) ? a : b;
+        append_fmt(out, "    %.*s\n", uint32_t(c.length), wordDB.str(c));
+      }
+      else {
+        append_fmt(out, "    %.*s -> %.*s\n", uint32_t(a.length), wordDB.str(a), uint32_t(b.length), wordDB.str(b));
+      }
+    }
+  }
+
+  void print_solutions(const WordDB& wordDB, const SolutionSet& solutions, uint32_t letter_count) {
+    std::string out;
+    append_fmt(out, "%d solutions\n=============\n", uint32_t(solutions.size()));
+    append_solutions(out, wordDB, solutions, letter_count);
+    BNG_PUTI(out.c_str());
+  }
+
+  struct BatchPuzzle {
+    WordDB::SideSet sides;
+    const char* line = nullptr;
+    uint32_t line_length = 0;
+    bool is_valid = false;
+  };
+
+  // one puzzle per line, 4 whitespace separated sides. blank lines and lines starting with # are skipped.
+  std::vector<BatchPuzzle> read_batch(const char* text, const char* text_end) {
+    std::vector<BatchPuzzle> puzzles;
+    for (const char* p = text; p < text_end; ) {
+      auto eol = (const char*)memchr(p, '\n', size_t(text_end - p));
+      eol = eol ? eol : text_end;
+      const char* line = p;
+      const char* line_end = eol;
+      p = eol + 1;
+
+      while (line < line_end && isspace(uint8_t(*line))) {
+        ++line;
+      }
+      while (line_end > line && isspace(uint8_t(*(line_end - 1)))) {
+        --line_end;
+      }
+      if (line == line_end || *line == '#') {
+        continue;
+      }
+
+      char side_strs[4][4] = {};
+      uint32_t side_count = 0;
+      bool is_valid = true;
+      for (const char* lp = line; lp < line_end; ) {
+        const char* tok = lp;
+        while (lp < line_end && !isspace(uint8_t(*lp))) {
+          ++lp;
+        }
+        const auto tok_len = uint32_t(lp - tok);
+        if (side_count < 4 && tok_len < 4) {
+          memcpy(side_strs[side_count], tok, tok_len);
+        }
+        else {
+          is_valid = false;
+        }
+        ++side_count;
+        while (lp < line_end && isspace(uint8_t(*lp))) {
+          ++lp;
+        }
+      }
+
+      auto& puzzle = puzzles.emplace_back();
+      puzzle.line = line;
+      puzzle.line_length = uint32_t(line_end - line);
+      const char* side_ptrs[4] = { side_strs[0], side_strs[1], side_strs[2], side_strs[3] };
+      puzzle.is_valid = is_valid && side_count == 4 && parse_sides(side_ptrs, puzzle.sides);
+    }
+    return puzzles;
+  }
+
+  // solves every puzzle in path against one loaded db. puzzles are solved
+  // concurrently and results written in input order.
+  // top_k 0 prints every solution. show_stats prints SolveStats summed over the batch.
+  // use_cache looks puzzles up in the result cache first. not with top_k.
+  int solve_batch(const std::filesystem::path& path, uint32_t thread_count, bool use_files, uint32_t top_k,
+    bool show_stats, bool use_cache)
+  {
+    double total_ms = FLT_MAX;
+    double preload_ms = FLT_MAX;
+    double solve_ms = FLT_MAX;
+    uint32_t puzzle_count = 0;
+    uint32_t invalid_count = 0;
+    SolveStats batch_stats;
+    thread_count = resolve_thread_count(thread_count);
+
+    {
+      auto _tt = ScopedTimer(&total_ms);
+
+      const auto path_str = path.generic_string();
+      auto batch_file = File(path_str.c_str(), "rb");
+      if (!batch_file) {
+        BNG_PRINT("failed opening %s\n", path_str.c_str());
+        return 1;
+      }
+      const auto text_size = batch_file.size_bytes();
+      auto text = std::make_unique<char[]>(text_size + 1);
+      const auto read_size = uint32_t(fread(text.get(), 1, text_size, batch_file));
+      text[read_size] = 0;
+
+      const auto puzzles = read_batch(text.get(), text.get() + read_size);
+      puzzle_count = uint32_t(puzzles.size());
+
+      WordDB wordDB;
+      {
+        auto _pt = ScopedTimer(&preload_ms);
+        auto _trace = BNG_TRACE_SCOPE("preload");
+        auto _timer = BNG_TIMED_SCOPE("preload");
+        wordDB = load_word_db(use_files);
+      }
+      auto cache = use_cache ? std::make_unique<ResultCache>(wordDB, kCacheName) : nullptr;
+
+      auto _st = ScopedTimer(&solve_ms);
+
+      auto results = std::make_unique<std::string[]>(puzzle_count);
+      auto ready = std::make_unique<std::atomic<bool>[]>(puzzle_count);
+      // per puzzle so workers never share counts.
+      auto puzzle_stats = std::make_unique<SolveStats[]>(show_stats ? puzzle_count : 0);
+      uint32_t next_write = 0;
+
+      // only called from the main thread.
+      auto write_ready = [&]() {
+        for (; next_write < puzzle_count && ready[next_write].load(std::memory_order_acquire); ++next_write) {
+          fwrite(results[next_write].data(), 1, results[next_write].size(), stdout);
+          results[next_write] = std::string();
+        }
+      };
+
+      parallel_for_chunks(puzzle_count, thread_count,
+        [&](uint32_t worker_i, uint32_t pi) {
+          auto _trace = BNG_TRACE_SCOPE("puzzle");
+          auto _timer = BNG_TIMED_SCOPE("puzzle");
+          const auto& puzzle = puzzles[pi];
+          auto& out = results[pi];
+          if (!puzzle.is_valid) {
+            append_fmt(out, "%.*s: invalid puzzle\n", puzzle.line_length, puzzle.line);
+          }
+          else {
+            SolveStats* stats = show_stats ? &puzzle_stats[pi] : nullptr;
+            // cached solutions index the loaded db. the others the culled one.
+            WordDB culledDB;
+            const WordDB* solutionsDB = &wordDB;
+            SolutionSet solutions;
+            if (cache) {
+              solutions = solve_cached(*cache, wordDB, puzzle.sides, 1, stats);
+              solutions.sort(wordDB);
+            }
+            else {
+              culledDB = wordDB.culled(puzzle.sides, stats);
+              solutionsDB = &culledDB;
+              if (top_k) {
+                solutions = culledDB.solve_top_k(puzzle.sides, top_k);
+              }
+              else {
+                solutions = culledDB.solve(puzzle.sides, 1, stats);
+                solutions.sort(culledDB);
+              }
+            }
+            append_fmt(out, "%.*s: %d solutions\n", puzzle.line_length, puzzle.line, uint32_t(solutions.size()));
+            append_solutions(out, *solutionsDB, solutions, WordDB::SideSet::kLetterCount);
+          }
+          ready[pi].store(true, std::memory_order_release);
+          if (worker_i == 0) {
+            write_ready();
+          }
+        });
+      write_ready();
+      fflush(stdout);
+
+      for (const auto& puzzle : puzzles) {
+        invalid_count += uint32_t(!puzzle.is_valid);
+      }
+      for (uint32_t pi = 0; show_stats && pi < puzzle_count; ++pi) {
+        batch_stats += puzzle_stats[pi];
+      }
+    }
+
+    BNG_PRINT("\n[orig] batch: %d puzzles (%d invalid) on %d threads  preload_time: %lgms  solve_time: %lgms  total_time: %lgms  %.1lf puzzles/sec\n",
+      puzzle_count, invalid_count, thread_count, preload_ms, solve_ms, total_ms,
+      solve_ms > 0.0 ? puzzle_count * 1000.0 / solve_ms : 0.0);
+    if (show_stats) {
+      print_stats(batch_stats);
+    }
+
+    return 0;
+  }
+
+  // cull, solve and sort one puzzle of any board WordDB is compiled for.
+  template<uint32_t SIDE_COUNT, uint32_t SIDE_WIDTH>
+  int solve_geometry(const char* const* side_strs, uint32_t thread_count, bool use_files, bool show_stats, bool use_cache) {
+    using Sides = BasicSideSet<SIDE_COUNT, SIDE_WIDTH>;
+    double total_ms = FLT_MAX;
+    double preload_ms = FLT_MAX;
+    double solve_ms = FLT_MAX;
+    WordDB wordDB;
+    SolutionSet solutions;
+    SolveStats stats;
+
+    {
+      auto _tt = ScopedTimer(&total_ms);
+
+      Sides sides;
+      if (!parse_sides(side_strs, sides)) {
+        BNG_PRINT("sides are not %d sides of %d unique letters.\n", SIDE_COUNT, SIDE_WIDTH);
+        return 1;
+      }
+
+      {
+        auto _pt = ScopedTimer(&preload_ms);
+        auto _trace = BNG_TRACE_SCOPE("preload");
+        auto _timer = BNG_TIMED_SCOPE("preload");
+        wordDB = load_word_db(use_files);
+      }
+
+      {
+        auto _st = ScopedTimer(&solve_ms);
+        if (use_cache) {
+          auto cache = ResultCache(wordDB, kCacheName);
+          solutions = solve_cached(cache, wordDB, sides, thread_count, show_stats ? &stats : nullptr);
+        }
+        else {
+          wordDB.cull(sides, thread_count, show_stats ? &stats : nullptr);
+          solutions = wordDB.solve(sides, thread_count, show_stats ? &stats : nullptr);
+        }
+      }
+    }
+
+    solutions.sort(wordDB);
+    print_solutions(wordDB, solutions, Sides::kLetterCount);
+    if (show_stats) {
+      print_stats(stats);
+    }
+    BNG_PRINT("\n[orig] %dx%d board  preload_time: %lgms  solve time: %lgms  total_time: %lgms\n",
+      SIDE_COUNT, SIDE_WIDTH, preload_ms, solve_ms, total_ms);
+    return 0;
+  }
+
+  using SolveGeometryFn = int(*)(const char* const* side_strs, uint32_t thread_count, bool use_files, bool show_stats, bool use_cache);
+
+  struct Geometry {
+    uint32_t side_count = 0;
+    uint32_t side_width = 0;
+    SolveGeometryFn solve = nullptr;
+  };
+
+  // picked at runtime from the number and length of the sides on the command line.
+#define BNG_LETTERBOXED_GEOMETRY(SIDE_COUNT, SIDE_WIDTH) \
+  Geometry{ SIDE_COUNT, SIDE_WIDTH, &solve_geometry<SIDE_COUNT, SIDE_WIDTH> },
+  const Geometry kGeometries[] = { BNG_WORD_DB_GEOMETRIES(BNG_LETTERBOXED_GEOMETRY) };
+#undef BNG_LETTERBOXED_GEOMETRY
+
+  const Geometry* find_geometry(uint32_t side_count, uint32_t side_width) {
+    for (const auto& g : kGeometries) {
+      if (g.side_count == side_count && g.side_width == side_width) {
+        return &g;
+      }
+    }
+    return nullptr;
+  }
 }
 
 namespace std_cmp {
@@ -118,15 +459,144 @@ int main(int argc, const char *argv[]) {
   const char** side_args = &argv[1];
   auto side_count = argc - 1;
   bool use_orig = true;
+  uint32_t thread_count = 1;
+  uint32_t max_words = 2;
+  const char* batch_path = nullptr;
+  bool threads_set = false;
+  bool use_classes = false;
+  bool use_complement = false;
+  bool count_only = false;
+  bool use_files = false;
+  bool show_stats = false;
+  bool show_timers = false;
+  bool use_cache = false;
+  uint32_t top_k = 0;
+  std::string trace_path;
+
+  for (; side_args[0] && !strncmp(side_args[0], "--", 2); ++side_args, --side_count) {
+    if (!strcmp(side_args[0], "--std")) {
+      use_orig = false;
+    }
+    else if (!strcmp(side_args[0], "--threads") && side_args[1]) {
+      // 0 uses all hardware threads.
+      thread_count = uint32_t(atoi(side_args[1]));
+      threads_set = true;
+      ++side_args;
+      --side_count;
+    }
+    else if (!strcmp(side_args[0], "--max-words") && side_args[1]) {
+      max_words = uint32_t(atoi(side_args[1]));
+      ++side_args;
+      --side_count;
+    }
+    else if (!strcmp(side_args[0], "--classes")) {
+      use_classes = true;
+    }
+    else if (!strcmp(side_args[0], "--complement")) {
+      use_complement = true;
+    }
+    else if (!strcmp(side_args[0], "--count")) {
+      count_only = true;
+    }
+    else if (!strcmp(side_args[0], "--files")) {
+      use_files = true;
+    }
+    else if (!strcmp(side_args[0], "--stats")) {
+      show_stats = true;
+    }
+    else if (!strcmp(side_args[0], "--timers")) {
+      show_timers = true;
+    }
+    else if (!strcmp(side_args[0], "--cache")) {
+      use_cache = true;
+    }
+    else if (!strcmp(side_args[0], "--trace") && side_args[1]) {
+      // resolved before moving to the exe directory.
+      trace_path = std::filesystem::absolute(side_args[1]).generic_string();
+      ++side_args;
+      --side_count;
+    }
+    else if (!strcmp(side_args[0], "--top") && side_args[1]) {
+      top_k = uint32_t(atoi(side_args[1]));
+      ++side_args;
+      --side_count;
+    }
+    else if (!strcmp(side_args[0], "--batch") && side_args[1]) {
+      batch_path = side_args[1];
+      ++side_args;
+      --side_count;
+    }
+    else {
+      side_count = 0;
+      break;
+    }
+  }
 
-  if (side_args[0] && !strcmp(side_args[0], "--std")) {
-    use_orig = false;
-    side_args += 1;
-    side_count -= 1;
+  if (!trace_path.empty()) {
+    trace::start(trace_path.c_str());
+  }
+  if (show_timers) {
+    timers::start();
+    atexit([]() {
+      BNG_PUTI("\ntimers:\n");
+      timers::report();
+    });
+  }
+
+  // cached results are of the plain two word solve.
+  const bool is_cache_misused = use_cache && (!use_orig || use_classes || use_complement || count_only || top_k || max_words > 2);
+  // batches are solved with the plain two word solve or --top, and take no sides.
+  const bool is_batch_misused = batch_path && (!use_orig || side_count || use_classes || use_complement || count_only || max_words > 2);
+  // solve stats are only counted by the plain two word cull and solve. a cache hit solves nothing.
+  const bool is_stats_misused = show_stats && (use_classes || use_complement || count_only || top_k || use_cache);
+
+  if (batch_path && !is_batch_misused && !is_cache_misused && !is_stats_misused) {
+    // resolve before moving to the exe directory.
+    const auto abs_batch_path = std::filesystem::absolute(batch_path);
+    std::filesystem::current_path(std::filesystem::path(argv[0]).parent_path());
+    // batches default to all hardware threads.
+    return orig::solve_batch(abs_batch_path, threads_set ? thread_count : 0, use_files, top_k, show_stats, use_cache);
+  }
+
+  // boards other than 4 sides of 3 letters only cull, solve and sort.
+  const auto side_width = side_count > 0 ? uint32_t(strlen(side_args[0])) : 0;
+  const auto geometry = (side_count == 4 && side_width == 3) ? nullptr : orig::find_geometry(side_count, side_width);
+  const bool is_geometry_misused = geometry &&
+    (!use_orig || batch_path || use_classes || use_complement || count_only || top_k || max_words > 2);
+  if (geometry && !is_geometry_misused && !is_stats_misused) {
+    std::filesystem::current_path(std::filesystem::path(argv[0]).parent_path());
+    return geometry->solve(side_args, thread_count, use_files, show_stats, use_cache);
   }
 
-  if (side_count != 4) {
-    BNG_PRINT("usage: [--std] <side> <side> <side> <side>\n  e.g. letterboxed vrq wue isl dmo\n");
+  if (side_count != 4 || is_cache_misused || is_batch_misused || is_stats_misused || is_geometry_misused ||
+    (!use_orig && (use_classes || use_complement || count_only || top_k || show_stats))) {
+    BNG_PUTI("usage: [--std] [--threads N] [--max-words N] [--classes | --complement | --top N] [--count] [--cache] [--files] [--stats] [--timers] [--trace FILE] <side> <side> <side> <side>\n  e.g. letterboxed vrq wue isl dmo\n"
+      "       [--threads N] [--cache] [--files] [--stats] [--timers] [--trace FILE] <side>...\n  e.g. letterboxed abcd efgh ijkl mnop\n"
+      "       [--threads N] [--top N | --cache] [--files] [--stats] [--timers] [--trace FILE] --batch <puzzle_file>\n  e.g. letterboxed --batch test_puzzles.txt\n"
+      "  <side>...      3 to 6 sides of 3 or 4 letters. boards other than 4 sides of 3 letters only take\n"
+      "                 the options shown for them.\n"
+      "  --std          use the std library based word_db\n"
+      "  --threads N    threads used to cull and solve. 0 uses all hardware threads. (default 1, not supported by --std)\n"
+      "  --batch FILE   solve every puzzle in FILE, one per line, against one loaded dictionary.\n"
+      "                 puzzles are solved concurrently (default all hardware threads) and written in input order.\n"
+      "                 batches only take the options shown for them.\n"
+      "  --max-words N  if there is no two word solution find the shortest chains of up to N (max 5) words. (not supported by --std)\n"
+      "  --classes      solve on words grouped by first letter, last letter and letter set. (not supported by --std)\n"
+      "  --complement   solve by looking up the words that supply each word's missing letters. (not supported by --std)\n"
+      "  --count        only print the number of two word solutions. (not supported by --std)\n"
+      "  --top N        only find the N shortest two word solutions. (not supported by --std)\n"
+      "  --cache        look the puzzle up in words_alpha.cache next to the executable before solving it, and\n"
+      "                 add it when it is not there. the same puzzle with its sides or letters in another order\n"
+      "                 is found too. only for the plain two word solve.\n"
+      "  --files        load words_alpha.pre / words_alpha.txt next to the executable instead of the\n"
+      "                 dictionary compiled into it. (--std always loads files)\n"
+      "  --stats        print words culled, candidates and pairs compared by cull and solve.\n"
+      "                 needs a build configured with -DBNG_SOLVE_STATS=ON. only for the plain two word solve\n"
+      "                 without --cache. (not supported by --std)\n"
+      "  --timers       print count, total, mean and percentile times of load, cull, solve and sort\n"
+      "                 nested under the phase that ran them, e.g. each puzzle of a batch, on exit.\n"
+      "  --trace FILE   write a chrome trace of load, cull, solve and sort on every thread to FILE on exit.\n"
+      "                 open it in ui.perfetto.dev or chrome://tracing.\n");
     return 1;
   }
 
@@ -141,6 +611,9 @@ int main(int argc, const char *argv[]) {
     WordDB wordDB;
     WordDB::SideSet sides;
     SolutionSet solutions;
+    ChainSet chains;
+    uint64_t solution_count = 0;
+    SolveStats stats;
 
     {
       auto _tt = ScopedTimer(&total_ms);
@@ -152,30 +625,66 @@ int main(int argc, const char *argv[]) {
 
       {
         auto _pt = ScopedTimer(&preload_ms);
-        wordDB = load_word_db();
+        auto _trace = BNG_TRACE_SCOPE("preload");
+        auto _timer = BNG_TIMED_SCOPE("preload");
+        wordDB = load_word_db(use_files);
       }
 
-      {
+      if (use_cache) {
+        auto _st = ScopedTimer(&solve_ms);
+        auto cache = ResultCache(wordDB, kCacheName);
+        solutions = solve_cached(cache, wordDB, sides, thread_count, show_stats ? &stats : nullptr);
+      }
+      else {
         auto _st = ScopedTimer(&solve_ms);
         // eliminate non-candidates and solve
-        wordDB.cull(sides);
-        solutions = wordDB.solve(sides);
+        wordDB.cull(sides, thread_count, show_stats ? &stats : nullptr);
+        if (use_classes) {
+          wordDB.build_class_index();
+        }
+        if (count_only) {
+          solution_count = wordDB.count_solutions(sides);
+        }
+        else {
+          if (top_k) {
+            solutions = wordDB.solve_top_k(sides, top_k);
+          }
+          else {
+            solutions = use_complement ? wordDB.solve_complement(sides) :
+              wordDB.solve(sides, thread_count, show_stats ? &stats : nullptr);
+          }
+          if (!solutions.size() && max_words > 2) {
+            chains = wordDB.solve_n(sides, max_words);
+          }
+        }
       }
     }
 
-    // show results
-    solutions.sort(wordDB);
-    BNG_PRINT("%d solutions\n=============\n", uint32_t(solutions.size()));
-    for (auto ps : solutions) {
-      auto& a = *wordDB.word(ps.a);
-      auto& b = *wordDB.word(ps.b);
-      if (a.letter_count == 12 || b.letter_count == 12) {
-        auto& c = (a.letter_count == 12) ? a : b;
-        BNG_PRINT("    %.*s\n", uint32_t(c.length), wordDB.str(c));
+    if (count_only) {
+      BNG_PRINT("%llu solutions\n", (unsigned long long)solution_count);
+    }
+    else if (chains.size()) {
+      chains.sort(wordDB);
+      BNG_PRINT("no two word solutions. %d solutions of %d words\n=============\n",
+        uint32_t(chains.size()), chains.word_count());
+      for (const auto& chain : chains) {
+        BNG_PUTI("   ");
+        for (uint32_t i = 0; i < chain.count; ++i) {
+          auto& w = *wordDB.word(chain.words[i]);
+          BNG_PRINT("%s%.*s", i ? " -> " : " ", uint32_t(w.length), wordDB.str(w));
+        }
+        BNG_PUTI("\n");
       }
-      else {
-        BNG_PRINT("    %.*s -> %.*s\n", uint32_t(a.length), wordDB.str(a), uint32_t(b.length), wordDB.str(b));
+    }
+    else {
+      // show results. top k solutions are already in order.
+      if (!top_k) {
+        solutions.sort(wordDB);
       }
+      print_solutions(wordDB, solutions, WordDB::SideSet::kLetterCount);
+    }
+    if (show_stats) {
+      print_stats(stats);
     }
   } 
   else {
@@ -0,0 +1,425 @@
+#include "core/core.h"
+#include "word_db/word_db.h"
+#include "word_db/word_db_std.h"
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <vector>
+
+using namespace bng::core;
+
+namespace {
+  // 4 sides of 3 letters, as on the command line.
+  struct Puzzle {
+    char sides[4][4] = {};
+  };
+
+  struct BenchConfig {
+    std::filesystem::path words_path;
+    uint32_t warmup_count = 1;
+    uint32_t trial_count = 5;
+    uint32_t thread_count = 1;
+    // for engines that can back their storage with huge pages.
+    bool use_huge_pages = false;
+  };
+
+  enum class Phase : uint32_t { load, cull, solve, sort, count };
+
+  const char* phase_name(Phase phase) {
+    static const char* names[] = { "load", "cull", "solve", "sort" };
+    return names[uint32_t(phase)];
+  }
+
+  // ms per puzzle per trial for each phase.
+  struct EngineSamples {
+    std::vector<double> phases[uint32_t(Phase::count)];
+    // solutions found in one trial over the whole corpus. every engine should agree.
+    uint64_t solution_count = 0;
+    bool is_loaded = false;
+  };
+
+  // runs every puzzle warmup_count + trial_count times, recording the trials.
+  using RunFn = void(*)(const BenchConfig& config, const std::vector<Puzzle>& puzzles, EngineSamples& samples);
+
+  struct Engine {
+    const char* name = nullptr;
+    RunFn run = nullptr;
+  };
+
+  // each puzzle is one letterboxed run: load the preprocessed dictionary, cull, solve and sort.
+  // pre_name is rebuilt from config.words_path when it is missing or stale.
+  template<typename WordDB>
+  void run_engine(const BenchConfig& config, const std::vector<Puzzle>& puzzles,
+    const char* pre_name, EngineSamples& samples)
+  {
+    const auto pre_path = std::filesystem::path(config.words_path).replace_filename(pre_name);
+    {
+      WordDB wordDB;
+      if (!wordDB.load(pre_path)) {
+        if (!wordDB.load(config.words_path)) {
+          BNG_PRINT("failed loading %s\n", config.words_path.generic_string().c_str());
+          return;
+        }
+        wordDB.save(pre_path);
+      }
+    }
+    samples.is_loaded = true;
+
+    for (uint32_t ti = 0; ti < config.warmup_count + config.trial_count; ++ti) {
+      const bool is_trial = ti >= config.warmup_count;
+      uint64_t solution_count = 0;
+      for (const auto& puzzle : puzzles) {
+        double phase_ms[uint32_t(Phase::count)] = {};
+        typename WordDB::SideSet sides;
+        for (uint32_t si = 0; si < 4; ++si) {
+          sides[si] = std::remove_reference_t<decltype(sides[si])>(puzzle.sides[si]);
+        }
+
+        WordDB wordDB;
+        {
+          auto _ = ScopedTimer(&phase_ms[uint32_t(Phase::load)]);
+          wordDB.load(pre_path);
+        }
+        // engines that can thread cull and solve get config.thread_count.
+        constexpr bool is_threaded = requires(WordDB& db) { db.cull(sides, 1u); db.solve(sides, 1u); };
+        if constexpr (requires(WordDB& db) { db.set_use_huge_pages(true); }) {
+          wordDB.set_use_huge_pages(config.use_huge_pages);
+        }
+        {
+          auto _ = ScopedTimer(&phase_ms[uint32_t(Phase::cull)]);
+          if constexpr (is_threaded) {
+            wordDB.cull(sides, config.thread_count);
+          }
+          else {
+            wordDB.cull(sides);
+          }
+        }
+        auto solutions = [&]() {
+          auto _ = ScopedTimer(&phase_ms[uint32_t(Phase::solve)]);
+          if constexpr (is_threaded) {
+            return wordDB.solve(sides, config.thread_count);
+          }
+          else {
+            return wordDB.solve(sides);
+          }
+        }();
+        {
+          auto _ = ScopedTimer(&phase_ms[uint32_t(Phase::sort)]);
+          solutions.sort(wordDB);
+        }
+
+        solution_count += solutions.size();
+        if (is_trial) {
+          for (uint32_t pi = 0; pi < uint32_t(Phase::count); ++pi) {
+            samples.phases[pi].push_back(phase_ms[pi]);
+          }
+        }
+      }
+      samples.solution_count = solution_count;
+    }
+  }
+
+  // new engines go here.
+  const Engine kEngines[] = {
+    { "orig", [](const BenchConfig& config, const std::vector<Puzzle>& puzzles, EngineSamples& samples) {
+        run_engine<bng::word_db::WordDB>(config, puzzles, "words_alpha.pre", samples);
+      } },
+    { "std", [](const BenchConfig& config, const std::vector<Puzzle>& puzzles, EngineSamples& samples) {
+        run_engine<bng::word_db_std::WordDB>(config, puzzles, "words_alpha.stp", samples);
+      } },
+  };
+
+  struct PhaseStats {
+    uint32_t count = 0;
+    double min = 0.0;
+    double median = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double mean = 0.0;
+  };
+
+  // nearest rank percentiles.
+  PhaseStats phase_stats(std::vector<double> samples) {
+    PhaseStats stats;
+    if (samples.empty()) {
+      return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+      const auto rank = size_t(p * double(samples.size()) + 0.999999);
+      return samples[std::clamp(rank, size_t(1), samples.size()) - 1];
+    };
+    stats.count = uint32_t(samples.size());
+    stats.min = samples.front();
+    stats.median = percentile(0.5);
+    stats.p95 = percentile(0.95);
+    stats.p99 = percentile(0.99);
+    for (auto s : samples) {
+      stats.mean += s;
+    }
+    stats.mean /= double(samples.size());
+    return stats;
+  }
+
+  // false if line is not 4 sides of 3 unique letters.
+  bool parse_puzzle(const std::string& line, Puzzle& puzzle) {
+    uint32_t side_count = 0;
+    uint32_t all_letters = 0;
+    for (size_t p = 0; p < line.size(); ) {
+      while (p < line.size() && isspace(uint8_t(line[p]))) {
+        ++p;
+      }
+      const size_t tok = p;
+      while (p < line.size() && !isspace(uint8_t(line[p]))) {
+        ++p;
+      }
+      if (p == tok) {
+        break;
+      }
+      if (side_count == 4 || p - tok != 3) {
+        return false;
+      }
+      for (size_t i = tok; i < p; ++i) {
+        const char c = char(tolower(line[i]));
+        const uint32_t bit = (c >= 'a' && c <= 'z') ? 1u << (c - 'a') : 0;
+        if (!bit || (all_letters & bit)) {
+          return false;
+        }
+        all_letters |= bit;
+        puzzle.sides[side_count][i - tok] = c;
+      }
+      ++side_count;
+    }
+    return side_count == 4;
+  }
+
+  // one puzzle per line. blank lines and lines starting with # are skipped.
+  bool read_puzzles(const char* path, std::vector<Puzzle>& puzzles) {
+    auto file = File(path, "rb");
+    if (!file) {
+      BNG_PRINT("failed opening %s\n", path);
+      return false;
+    }
+    char line_buf[256];
+    for (uint32_t line_i = 1; fgets(line_buf, sizeof(line_buf), file); ++line_i) {
+      std::string line = line_buf;
+      const auto first = line.find_first_not_of(" \t\r\n");
+      if (first == std::string::npos || line[first] == '#') {
+        continue;
+      }
+      Puzzle puzzle;
+      if (!parse_puzzle(line, puzzle)) {
+        BNG_PRINT("%s(%d): not 4 sides of 3 unique letters. skipping.\n", path, line_i);
+        continue;
+      }
+      puzzles.push_back(puzzle);
+    }
+    return true;
+  }
+
+  // count random puzzles of 12 distinct letters. the same seed gives the same corpus.
+  void generate_puzzles(uint32_t count, uint32_t seed, std::vector<Puzzle>& puzzles) {
+    uint32_t x = seed ? seed : 0x2545f491u;
+    auto next_rand = [&x]() {
+      x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+      return x;
+    };
+    for (uint32_t pi = 0; pi < count; ++pi) {
+      char letters[26];
+      for (uint32_t li = 0; li < 26; ++li) {
+        letters[li] = char('a' + li);
+      }
+      // partial fisher-yates. the first 12 letters are the puzzle.
+      for (uint32_t li = 0; li < 12; ++li) {
+        std::swap(letters[li], letters[li + next_rand() % (26 - li)]);
+      }
+      Puzzle puzzle;
+      for (uint32_t li = 0; li < 12; ++li) {
+        puzzle.sides[li / 3][li % 3] = letters[li];
+      }
+      puzzles.push_back(puzzle);
+    }
+  }
+
+  void write_json(FILE* out, const BenchConfig& config, const std::vector<const char*>& corpus_paths,
+    uint32_t generated_count, uint32_t seed, uint32_t puzzle_count,
+    const std::vector<const Engine*>& engines, const std::vector<EngineSamples>& samples)
+  {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"corpus\": { \"puzzles\": %u, \"generated\": %u, \"seed\": %u, \"files\": [", puzzle_count, generated_count, seed);
+    for (size_t i = 0; i < corpus_paths.size(); ++i) {
+      fprintf(out, "%s\"", i ? ", " : "");
+      for (const char* p = corpus_paths[i]; *p; ++p) {
+        if (*p == '"' || *p == '\\') {
+          fputc('\\', out);
+        }
+        fputc(*p, out);
+      }
+      fputc('"', out);
+    }
+    fprintf(out, "] },\n");
+    fprintf(out, "  \"warmup\": %u,\n  \"trials\": %u,\n  \"threads\": %u,\n  \"huge_pages\": %s,\n  \"units\": \"ms\",\n",
+      config.warmup_count, config.trial_count, config.thread_count, config.use_huge_pages ? "true" : "false");
+    fprintf(out, "  \"engines\": [\n");
+    for (size_t ei = 0; ei < engines.size(); ++ei) {
+      fprintf(out, "    { \"name\": \"%s\", \"solutions\": %llu, \"phases\": {\n",
+        engines[ei]->name, (unsigned long long)samples[ei].solution_count);
+      for (uint32_t pi = 0; pi < uint32_t(Phase::count); ++pi) {
+        const auto stats = phase_stats(samples[ei].phases[pi]);
+        fprintf(out, "      \"%s\": { \"samples\": %u, \"min\": %.6f, \"median\": %.6f, \"p95\": %.6f, \"p99\": %.6f, \"mean\": %.6f }%s\n",
+          phase_name(Phase(pi)), stats.count, stats.min, stats.median, stats.p95, stats.p99, stats.mean,
+          pi + 1 < uint32_t(Phase::count) ? "," : "");
+      }
+      fprintf(out, "    } }%s\n", ei + 1 < engines.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+  }
+}
+
+int main(int argc, const char* argv[]) {
+  BenchConfig config;
+  std::vector<const Engine*> engines;
+  std::vector<const char*> corpus_paths;
+  const char* json_path = nullptr;
+  const char* words_arg = nullptr;
+  uint32_t generated_count = 0;
+  uint32_t seed = 1;
+  bool is_usage = false;
+
+  for (int ai = 1; ai < argc; ++ai) {
+    const char* arg = argv[ai];
+    const char* value = (ai + 1 < argc) ? argv[ai + 1] : nullptr;
+    if (!strcmp(arg, "--engine") && value) {
+      const Engine* engine = nullptr;
+      for (const auto& e : kEngines) {
+        engine = !strcmp(e.name, value) ? &e : engine;
+      }
+      if (!engine) {
+        BNG_PRINT("unknown engine %s\n", value);
+        return 1;
+      }
+      engines.push_back(engine);
+      ++ai;
+    }
+    else if (!strcmp(arg, "--warmup") && value) {
+      config.warmup_count = uint32_t(atoi(value));
+      ++ai;
+    }
+    else if (!strcmp(arg, "--trials") && value) {
+      config.trial_count = std::max(uint32_t(atoi(value)), 1u);
+      ++ai;
+    }
+    else if (!strcmp(arg, "--threads") && value) {
+      config.thread_count = uint32_t(atoi(value));
+      ++ai;
+    }
+    else if (!strcmp(arg, "--huge-pages")) {
+      config.use_huge_pages = true;
+    }
+    else if (!strcmp(arg, "--generate") && value) {
+      generated_count = uint32_t(atoi(value));
+      ++ai;
+    }
+    else if (!strcmp(arg, "--seed") && value) {
+      seed = uint32_t(strtoul(value, nullptr, 10));
+      ++ai;
+    }
+    else if (!strcmp(arg, "--words") && value) {
+      words_arg = value;
+      ++ai;
+    }
+    else if (!strcmp(arg, "--json") && value) {
+      json_path = value;
+      ++ai;
+    }
+    else if (!strncmp(arg, "--", 2)) {
+      is_usage = true;
+      break;
+    }
+    else {
+      corpus_paths.push_back(arg);
+    }
+  }
+
+  if (is_usage || (corpus_paths.empty() && !generated_count)) {
+    BNG_PUTI("usage: letterboxed_bench [--engine NAME]... [--warmup N] [--trials N] [--threads N] [--huge-pages]\n"
+      "         [--generate N] [--seed N] [--words FILE] [--json FILE] [puzzle_file]...\n"
+      "  e.g. letterboxed_bench --generate 1000 --json bench.json test_puzzles.txt\n"
+      "  --engine NAME  engine to run. repeat for more than one. (default all: orig std)\n"
+      "  --warmup N     untimed runs over the corpus before the trials. (default 1)\n"
+      "  --trials N     timed runs over the corpus. (default 5)\n"
+      "  --threads N    threads for engines that can cull and solve in parallel. 0 uses all hardware threads. (default 1)\n"
+      "  --huge-pages   back culled dictionaries with transparent huge pages where supported. (orig only)\n"
+      "  --generate N   add N random puzzles to the corpus.\n"
+      "  --seed N       seed for --generate. (default 1)\n"
+      "  --words FILE   word list. (default words_alpha.txt next to the executable)\n"
+      "  --json FILE    write min, median, p95, p99 and mean of each phase as json. - writes to stdout.\n");
+    return 1;
+  }
+
+  if (engines.empty()) {
+    for (const auto& e : kEngines) {
+      engines.push_back(&e);
+    }
+  }
+  config.words_path = words_arg ? std::filesystem::absolute(words_arg) :
+    std::filesystem::absolute(std::filesystem::path(argv[0]).parent_path() / "words_alpha.txt");
+
+  std::vector<Puzzle> puzzles;
+  for (auto path : corpus_paths) {
+    if (!read_puzzles(path, puzzles)) {
+      return 1;
+    }
+  }
+  generate_puzzles(generated_count, seed, puzzles);
+  if (puzzles.empty()) {
+    BNG_PUTI("no puzzles\n");
+    return 1;
+  }
+
+  std::vector<EngineSamples> samples(engines.size());
+  for (size_t ei = 0; ei < engines.size(); ++ei) {
+    engines[ei]->run(config, puzzles, samples[ei]);
+    if (!samples[ei].is_loaded) {
+      return 1;
+    }
+  }
+
+  // the table always goes to stdout, unless the json does.
+  const bool is_json_stdout = json_path && !strcmp(json_path, "-");
+  if (!is_json_stdout) {
+    BNG_PRINT("%d puzzles  %d warmup  %d trials  %d threads%s\n",
+      uint32_t(puzzles.size()), config.warmup_count, config.trial_count, config.thread_count,
+      config.use_huge_pages ? "  huge pages" : "");
+    BNG_PUTI("engine  phase      min ms   median ms      p95 ms      p99 ms\n");
+    for (size_t ei = 0; ei < engines.size(); ++ei) {
+      for (uint32_t pi = 0; pi < uint32_t(Phase::count); ++pi) {
+        const auto stats = phase_stats(samples[ei].phases[pi]);
+        BNG_PRINT("%-7s %-6s %10.4f  %10.4f  %10.4f  %10.4f\n",
+          engines[ei]->name, phase_name(Phase(pi)), stats.min, stats.median, stats.p95, stats.p99);
+      }
+    }
+  }
+
+  for (size_t ei = 1; ei < engines.size(); ++ei) {
+    if (samples[ei].solution_count != samples[0].solution_count) {
+      BNG_PRINT("%s found %llu solutions, %s found %llu\n",
+        engines[ei]->name, (unsigned long long)samples[ei].solution_count,
+        engines[0]->name, (unsigned long long)samples[0].solution_count);
+    }
+  }
+
+  if (is_json_stdout) {
+    write_json(stdout, config, corpus_paths, generated_count, seed, uint32_t(puzzles.size()), engines, samples);
+  }
+  else if (json_path) {
+    auto json_file = File(json_path, "w");
+    if (!json_file) {
+      BNG_PRINT("failed opening %s\n", json_path);
+      return 1;
+    }
+    write_json(json_file, config, corpus_paths, generated_count, seed, uint32_t(puzzles.size()), engines, samples);
+  }
+
+  return 0;
+}
@@ -0,0 +1,101 @@
+#include "complement_index.h"
+
+namespace bng::word_db {
+  //
+  // ComplementIndex
+  //
+
+  ComplementIndex::ComplementIndex(const WordDB& db, uint32_t all_letters)
+    : alphabet(all_letters)
+  {
+    for (uint32_t local_i = 0; local_i < kPuzzleLetterCount; ++local_i) {
+      for (auto wp = db.first_word(alphabet.letter(local_i)); wp && *wp; ++wp) {
+        word_count += alphabet.contains(uint32_t(wp->letters)) ? 1 : 0;
+      }
+    }
+
+    words = std::make_unique<WordIdx[]>(word_count);
+    masks = std::make_unique<uint16_t[]>(word_count);
+    last_local = std::make_unique<uint8_t[]>(word_count);
+    bucket_words = std::make_unique<WordIdx[]>(word_count);
+    bucket_begin = std::make_unique<uint32_t[]>(kPuzzleLetterCount * kLocalMaskCount + 1);
+    superset_count = std::make_unique<uint32_t[]>(kPuzzleLetterCount * kLocalMaskCount);
+
+    // words that use letters outside the puzzle can't be part of a solution.
+    uint32_t* bucket_sizes = superset_count.get();
+    uint32_t row_words_begin[kPuzzleLetterCount + 1] = {};
+    for (uint32_t local_i = 0, i = 0; local_i < kPuzzleLetterCount; ++local_i) {
+      row_words_begin[local_i] = i;
+      for (auto wp = db.first_word(alphabet.letter(local_i)); wp && *wp; ++wp) {
+        if (!alphabet.contains(uint32_t(wp->letters))) {
+          continue;
+        }
+        words[i] = db.word_i(*wp);
+        masks[i] = uint16_t(alphabet.local_mask(uint32_t(wp->letters)));
+        last_local[i] = uint8_t(alphabet.local_letter(db.last_letter_idx(*wp)));
+        ++bucket_sizes[bucket_i(local_i, masks[i])];
+        ++i;
+      }
+    }
+    row_words_begin[kPuzzleLetterCount] = word_count;
+
+    // counting sort into buckets. filling backwards from each bucket end leaves
+    // bucket_begin at the bucket starts and keeps words in row order.
+    uint32_t offset = 0;
+    for (uint32_t b = 0; b < kPuzzleLetterCount * kLocalMaskCount; ++b) {
+      offset += bucket_sizes[b];
+      bucket_begin[b] = offset;
+    }
+    bucket_begin[kPuzzleLetterCount * kLocalMaskCount] = offset;
+    for (uint32_t local_i = kPuzzleLetterCount; local_i-- > 0; ) {
+      for (uint32_t i = row_words_begin[local_i + 1]; i-- > row_words_begin[local_i]; ) {
+        bucket_words[--bucket_begin[bucket_i(local_i, masks[i])]] = words[i];
+      }
+    }
+
+    sum_over_supersets<kPuzzleLetterCount>(superset_count.get(),
+      [](uint32_t lhs, uint32_t rhs) { return lhs + rhs; });
+  }
+
+  uint64_t ComplementIndex::count() const {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < word_count; ++i) {
+      total += pair_count(i);
+    }
+    return total;
+  }
+
+  SolutionSet ComplementIndex::solve() const {
+    const uint64_t solution_count = count();
+    BNG_VERIFY(solution_count <= ~0u, "too many solutions");
+    auto solutions = SolutionSet(uint32_t(solution_count));
+
+    for (uint32_t i = 0; i < word_count; ++i) {
+      if (!pair_count(i)) {
+        continue;
+      }
+      // every bucket in the last letter row whose mask covers the missing letters.
+      const uint32_t need = kLocalFullMask & ~masks[i];
+      visit_supersets(last_local[i], need, masks[i], words[i], solutions);
+    }
+
+    return solutions;
+  }
+
+  // adds bits from free in increasing order so each superset is visited once.
+  // subtrees without any words are skipped using the superset counts.
+  void ComplementIndex::visit_supersets(
+    uint32_t local_i, uint32_t mask, uint32_t free, WordIdx a, SolutionSet& solutions) const
+  {
+    const uint32_t b = bucket_i(local_i, mask);
+    for (uint32_t bwi = bucket_begin[b]; bwi < bucket_begin[b + 1]; ++bwi) {
+      solutions.add(a, bucket_words[bwi]);
+    }
+    for (; free; free &= (free - 1)) {
+      const uint32_t next = mask | (free & (0u - free));
+      if (superset_count[bucket_i(local_i, next)]) {
+        visit_supersets(local_i, next, free & (free - 1), a, solutions);
+      }
+    }
+  }
+} // namespace bng::word_db
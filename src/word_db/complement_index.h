@@ -0,0 +1,110 @@
+#pragma once
+#include "word_db.h"
+#include <memory>
+
+namespace bng::word_db {
+  // every valid puzzle has exactly 12 letters. remapped to bits 0-11
+  // the letter mask of any playable word fits in 12 bits.
+  constexpr uint32_t kPuzzleLetterCount = 12;
+  constexpr uint32_t kLocalMaskCount = 1u << kPuzzleLetterCount;
+  constexpr uint32_t kLocalFullMask = kLocalMaskCount - 1;
+
+  // maps the 12 letters of a puzzle to local letters 0-11 in alphabetical order.
+  class PuzzleAlphabet {
+  public:
+    explicit PuzzleAlphabet(uint32_t all_letters) : all_letters(all_letters) {
+      for (uint32_t li = 0, local_i = 0; li < 26; ++li) {
+        if (all_letters & (1u << li)) {
+          local_of[li] = uint8_t(local_i);
+          letter_of[local_i++] = uint8_t(li);
+        }
+      }
+    }
+
+    bool contains(uint32_t letters) const {
+      return (letters | all_letters) == all_letters;
+    }
+
+    // letters must be contained in the alphabet.
+    uint32_t local_mask(uint32_t letters) const {
+      uint32_t mask = 0;
+      for (; letters; letters &= (letters - 1)) {
+        mask |= 1u << local_of[count_bits((letters & (0u - letters)) - 1)];
+      }
+      return mask;
+    }
+
+    uint32_t local_letter(uint32_t letter_i) const {
+      return local_of[letter_i];
+    }
+
+    uint32_t letter(uint32_t local_i) const {
+      return letter_of[local_i];
+    }
+
+  private:
+    uint32_t all_letters = 0;
+    uint8_t local_of[26] = {};
+    uint8_t letter_of[kPuzzleLetterCount] = {};
+  };
+
+
+  // sum over supersets: afterwards table[m] combines table[s] of every superset s of m.
+  // table holds kLanes independent entries per mask, interleaved as [mask][lane].
+  template<uint32_t kLanes = 1, typename T, typename F>
+  void sum_over_supersets(T* table, F&& combine) {
+    // masks without bit are the low halves of 2 * bit sized blocks.
+    // branch free with a fixed lane count so it vectorizes.
+    for (uint32_t bit = 1; bit < kLocalMaskCount; bit <<= 1) {
+      for (uint32_t block = 0; block < kLocalMaskCount; block += 2 * bit) {
+        T* lo = table + block * kLanes;
+        const T* hi = lo + bit * kLanes;
+        for (uint32_t i = 0; i < bit * kLanes; ++i) {
+          lo[i] = combine(lo[i], hi[i]);
+        }
+      }
+    }
+  }
+
+
+  // playable words of one puzzle bucketed by (local letter mask, local first letter).
+  // superset counts per first letter let a word find the words completing the puzzle
+  // by its missing letters instead of scanning the whole row.
+  class ComplementIndex {
+  public:
+    BNG_DECL_NO_COPY(ComplementIndex);
+
+    ComplementIndex(const WordDB& db, uint32_t all_letters);
+
+    // number of word pairs completing the puzzle. O(words).
+    uint64_t count() const;
+
+    SolutionSet solve() const;
+
+  private:
+    // first letter rows are interleaved per mask so the superset sums run on all rows at once.
+    static uint32_t bucket_i(uint32_t local_i, uint32_t mask) {
+      return mask * kPuzzleLetterCount + local_i;
+    }
+
+    void visit_supersets(
+      uint32_t local_i, uint32_t mask, uint32_t free, WordIdx a, SolutionSet& solutions) const;
+
+    uint32_t pair_count(uint32_t word_i) const {
+      return superset_count[bucket_i(last_local[word_i], kLocalFullMask & ~masks[word_i])];
+    }
+
+  private:
+    PuzzleAlphabet alphabet;
+    uint32_t word_count = 0;
+    // per indexed word, in first letter row order
+    std::unique_ptr<WordIdx[]> words;
+    std::unique_ptr<uint16_t[]> masks;
+    std::unique_ptr<uint8_t[]> last_local;
+    // words grouped by bucket. bucket b is [bucket_begin[b], bucket_begin[b + 1])
+    std::unique_ptr<WordIdx[]> bucket_words;
+    std::unique_ptr<uint32_t[]> bucket_begin;
+    // number of words in first letter row l with a mask that is a superset of m
+    std::unique_ptr<uint32_t[]> superset_count;
+  };
+} // namespace bng::word_db
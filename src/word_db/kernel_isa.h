@@ -0,0 +1,15 @@
+#pragma once
+// per function instruction set targets for the kernels. only kernel sources include this.
+
+#if defined(__x86_64__) || defined(_M_X64)
+# define BNG_KERNEL_X86 1
+# include <immintrin.h>
+# if defined(BNG_IS_MSVC)
+#   include <intrin.h>
+#   define BNG_TARGET_AVX2
+#   define BNG_TARGET_AVX512
+# else
+#   define BNG_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#   define BNG_TARGET_AVX512 __attribute__((target("avx512f,popcnt")))
+# endif
+#endif
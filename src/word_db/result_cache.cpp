@@ -0,0 +1,263 @@
+#include "result_cache.h"
+#include <algorithm>
+
+namespace bng::word_db {
+  namespace {
+    // result store layout: StoreHeader, then a StoreRecord and its solutions per added result.
+    // records are appended whole. a record that is cut short or fails its checksum ends the store.
+    struct StoreHeader {
+      static constexpr uint64_t kMagic = 0x5345525f42445742ull; // "BWDB_RES"
+      static constexpr uint32_t kVersion = 1;
+
+      uint64_t magic = kMagic;
+      uint32_t version = kVersion;
+      uint32_t header_size = sizeof(StoreHeader);
+      // the dictionary whose words the solutions index.
+      uint64_t fingerprint = 0;
+      uint64_t word_count = 0;
+    };
+    static_assert(std::is_trivially_copyable_v<StoreHeader>);
+
+    struct StoreRecord {
+      PuzzleKey key;
+      uint32_t solution_count = 0;
+      uint32_t reserved = 0;
+      // hash_bytes of the solutions, seeded with the key's hash.
+      uint64_t checksum = 0;
+    };
+    static_assert(std::is_trivially_copyable_v<StoreRecord> && !(sizeof(StoreRecord) % alignof(Solution)));
+
+    uint64_t record_checksum(uint64_t key_hash, const Solution* solutions, uint32_t solution_count) {
+      return hash_bytes(solutions, solution_count * sizeof(Solution), key_hash);
+    }
+
+    // true if the file at path starts with header.
+    bool has_header(const char* path, const StoreHeader& header) {
+      auto fin = File(path, "rb");
+      StoreHeader file_header;
+      return fin && fread(&file_header, sizeof(file_header), 1, fin) == 1 &&
+        !memcmp(&file_header, &header, sizeof(header));
+    }
+
+    SolutionSet copy_solutions(const Solution* solutions, uint32_t solution_count) {
+      SolutionSet out(solution_count);
+      if (solution_count) {
+        memcpy(out.begin(), solutions, solution_count * sizeof(Solution));
+        out.set_size(solution_count);
+      }
+      return out;
+    }
+  } // namespace
+
+  ResultCache::ResultCache(const WordDB& wordDB, const std::filesystem::path& store_path, uint32_t capacity)
+    : wordDB(wordDB), store_path(store_path.generic_string()), capacity(capacity) {
+    if (!this->store_path.empty()) {
+      lock_path = this->store_path + ".lock";
+    }
+    entries = std::make_unique<Entry[]>(capacity);
+    if (!this->store_path.empty()) {
+      open_store();
+    }
+  }
+
+  void ResultCache::open_store() {
+    auto _trace = BNG_TRACE_SCOPE("cache_open");
+    auto _timer = BNG_TIMED_SCOPE("cache_open");
+    // appends hold the lock, so a record cut short now was torn by a process that died.
+    const core::FileLock lock(lock_path.c_str());
+    store = core::MappedFile(store_path.c_str());
+    StoreHeader header;
+    if (!store || store.size() < sizeof(header)) {
+      store = core::MappedFile();
+      return;
+    }
+    memcpy((void*)&header, store.data(), sizeof(header));
+    if (header.magic != StoreHeader::kMagic ||
+      header.version != StoreHeader::kVersion ||
+      header.header_size != sizeof(StoreHeader) ||
+      header.fingerprint != wordDB.get_fingerprint() ||
+      header.word_count != wordDB.get_text_stats().total_count(/*null_terminated*/true)) {
+      // another dictionary. the store is rewritten for this one on the first add.
+      store = core::MappedFile();
+      return;
+    }
+
+    // index the whole records. the store is read in place, so only their offsets are kept.
+    const uint64_t size = store.size();
+    stored_results = std::make_unique<StoredResult[]>((size - sizeof(StoreHeader)) / sizeof(StoreRecord));
+    uint64_t offset = sizeof(StoreHeader);
+    while (size - offset >= sizeof(StoreRecord)) {
+      StoreRecord record;
+      memcpy((void*)&record, store.data() + offset, sizeof(record));
+      const uint64_t solutions_size = uint64_t(record.solution_count) * sizeof(Solution);
+      const auto solutions = reinterpret_cast<const Solution*>(store.data() + offset + sizeof(StoreRecord));
+      const uint64_t key_hash = record.key.hash();
+      if (solutions_size > size - offset - sizeof(StoreRecord) ||
+        record_checksum(key_hash, solutions, record.solution_count) != record.checksum) {
+        break;
+      }
+      stored_results[stored_result_count++] = StoredResult{ key_hash, offset };
+      offset += sizeof(StoreRecord) + solutions_size;
+    }
+    store_end = offset;
+    std::sort(stored_results.get(), stored_results.get() + stored_result_count,
+      [](const StoredResult& lhs, const StoredResult& rhs) {
+        return lhs.hash < rhs.hash;
+      });
+
+    // the rest is an append cut short, e.g. by a killed run. cut it off so later appends
+    // follow the last whole record. a mapped file can't be cut on every platform, so it is
+    // unmapped first and mapped again after. the index only holds offsets.
+    if (store_end < size) {
+      store = core::MappedFile();
+      std::error_code ec;
+      if (lock) {
+        std::filesystem::resize_file(store_path, store_end, ec);
+      }
+      // left in place, the torn record would end the store before anything appended here.
+      is_store_read_only = !lock || ec;
+      store = core::MappedFile(store_path.c_str());
+      if (!store || store.size() < store_end) {
+        store = core::MappedFile();
+        stored_result_count = 0;
+        store_end = 0;
+      }
+    }
+  }
+
+  bool ResultCache::find(const PuzzleKey& key, SolutionSet& solutions) {
+    auto _trace = BNG_TRACE_SCOPE("cache_find");
+    auto _timer = BNG_TIMED_SCOPE("cache_find");
+    const uint64_t hash = key.hash();
+    std::lock_guard lock(mutex);
+
+    for (uint32_t ei = 0; ei < entry_count; ++ei) {
+      auto& entry = entries[ei];
+      if (entry.hash == hash && entry.key == key) {
+        entry.last_used = ++use_count;
+        solutions = copy_solutions(entry.solutions.get(), entry.solution_count);
+        return true;
+      }
+    }
+
+    if (const uint8_t* record_ptr = find_stored(key, hash)) {
+      StoreRecord record;
+      memcpy((void*)&record, record_ptr, sizeof(record));
+      const auto stored = reinterpret_cast<const Solution*>(record_ptr + sizeof(StoreRecord));
+      remember(key, hash, stored, record.solution_count);
+      solutions = copy_solutions(stored, record.solution_count);
+      return true;
+    }
+    return false;
+  }
+
+  SolutionSet ResultCache::add(const PuzzleKey& key, const WordDB& solvedDB, const SolutionSet& solutions) {
+    auto _trace = BNG_TRACE_SCOPE("cache_add");
+    auto _timer = BNG_TIMED_SCOPE("cache_add");
+    // the solved db is a packed copy with its own word indices. its words are found in
+    // the dictionary by their text.
+    auto dictionary_i = [&](WordIdx solved_i) {
+      const auto& w = *solvedDB.word(solved_i);
+      return (&solvedDB == &wordDB) ? solved_i : wordDB.find_word(solvedDB.str(w), uint32_t(w.length));
+    };
+    SolutionSet translated(uint32_t(solutions.size()));
+    for (const auto& s : solutions) {
+      const auto a = dictionary_i(s.a);
+      const auto b = dictionary_i(s.b);
+      BNG_VERIFY(a != WordIdx::kInvalid && b != WordIdx::kInvalid, "solved words are not in the cache's dictionary");
+      if (a == WordIdx::kInvalid || b == WordIdx::kInvalid) {
+        // not solved with this dictionary. nothing is cached for it.
+        return translated;
+      }
+      translated.add(a, b);
+    }
+
+    const uint64_t hash = key.hash();
+    std::lock_guard lock(mutex);
+    remember(key, hash, translated.begin(), uint32_t(translated.size()));
+    if (!store_path.empty()) {
+      append(key, translated.begin(), uint32_t(translated.size()));
+    }
+    return translated;
+  }
+
+  const uint8_t* ResultCache::find_stored(const PuzzleKey& key, uint64_t hash) const {
+    auto it = std::lower_bound(stored_results.get(), stored_results.get() + stored_result_count, hash,
+      [](const StoredResult& lhs, uint64_t rhs) {
+        return lhs.hash < rhs;
+      });
+    for (; it != stored_results.get() + stored_result_count && it->hash == hash; ++it) {
+      const uint8_t* record_ptr = store.data() + it->offset;
+      if (!memcmp(record_ptr + offsetof(StoreRecord, key), &key, sizeof(key))) {
+        return record_ptr;
+      }
+    }
+    return nullptr;
+  }
+
+  void ResultCache::remember(const PuzzleKey& key, uint64_t hash, const Solution* solutions, uint32_t solution_count) {
+    if (!capacity) {
+      return;
+    }
+    Entry* entry = entries.get() + entry_count;
+    if (entry_count < capacity) {
+      ++entry_count;
+    }
+    else {
+      entry = std::min_element(entries.get(), entries.get() + entry_count,
+        [](const Entry& lhs, const Entry& rhs) {
+          return lhs.last_used < rhs.last_used;
+        });
+    }
+    entry->key = key;
+    entry->hash = hash;
+    entry->last_used = ++use_count;
+    entry->solutions = std::make_unique<Solution[]>(solution_count);
+    entry->solution_count = solution_count;
+    if (solution_count) {
+      memcpy(entry->solutions.get(), solutions, solution_count * sizeof(Solution));
+    }
+  }
+
+  void ResultCache::append(const PuzzleKey& key, const Solution* solutions, uint32_t solution_count) {
+    if (is_store_read_only) {
+      return;
+    }
+    // held while the record is written, so no other process cuts it off or writes into it.
+    const core::FileLock lock(lock_path.c_str());
+    if (!lock) {
+      return;
+    }
+    if (!store_end) {
+      // no store when this cache opened it, or one of another dictionary. another process
+      // may have written one of this dictionary since.
+      StoreHeader header;
+      header.fingerprint = wordDB.get_fingerprint();
+      header.word_count = wordDB.get_text_stats().total_count(/*null_terminated*/true);
+      if (!has_header(store_path.c_str(), header)) {
+        auto fout = File(store_path.c_str(), "wb");
+        if (!fout || fwrite(&header, sizeof(header), 1, fout) != 1) {
+          return;
+        }
+      }
+      store_end = sizeof(header);
+    }
+
+    // written whole, so a run killed while appending leaves at most one torn record at the
+    // end, which is cut off the next time the store is opened.
+    StoreRecord record;
+    record.key = key;
+    record.solution_count = solution_count;
+    record.checksum = record_checksum(key.hash(), solutions, solution_count);
+    const uint64_t record_size = sizeof(record) + uint64_t(solution_count) * sizeof(Solution);
+    auto image = std::make_unique<uint8_t[]>(record_size);
+    memcpy(image.get(), (const void*)&record, sizeof(record));
+    if (solution_count) {
+      memcpy(image.get() + sizeof(record), solutions, solution_count * sizeof(Solution));
+    }
+    auto fout = File(store_path.c_str(), "ab");
+    if (fout && fwrite(image.get(), record_size, 1, fout) == 1) {
+      store_end += record_size;
+    }
+  }
+} // namespace bng::word_db
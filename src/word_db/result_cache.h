@@ -0,0 +1,119 @@
+#pragma once
+#include "word_db.h"
+#include "core/file_lock.h"
+#include <mutex>
+#include <string>
+
+namespace bng::word_db {
+  // a puzzle of any geometry and the dictionary it is solved with. made from the canonical
+  // sides, so every listing of the same puzzle has the same key.
+  struct PuzzleKey {
+    static constexpr uint32_t kMaxSideCount = 6;
+
+    // WordDB::get_fingerprint of the dictionary.
+    uint64_t fingerprint = 0;
+    uint32_t side_count = 0;
+    uint32_t side_width = 0;
+    // letter masks of the canonical sides. unused sides are 0.
+    uint32_t sides[kMaxSideCount] = {};
+
+    PuzzleKey() = default;
+
+    template<uint32_t SIDE_COUNT, uint32_t SIDE_WIDTH>
+    PuzzleKey(const BasicSideSet<SIDE_COUNT, SIDE_WIDTH>& puzzle_sides, uint64_t dictionary_fingerprint) {
+      static_assert(SIDE_COUNT <= kMaxSideCount, "too many sides for a key");
+      const auto canonical = puzzle_sides.canonical();
+      fingerprint = dictionary_fingerprint;
+      side_count = SIDE_COUNT;
+      side_width = SIDE_WIDTH;
+      for (uint32_t si = 0; si < SIDE_COUNT; ++si) {
+        sides[si] = uint32_t(canonical[si].letters);
+      }
+    }
+
+    bool operator ==(const PuzzleKey& rhs) const {
+      return !memcmp(this, &rhs, sizeof(*this));
+    }
+
+    uint64_t hash() const {
+      return hash_bytes(this, sizeof(*this));
+    }
+  };
+  static_assert(std::is_trivially_copyable_v<PuzzleKey> && sizeof(PuzzleKey) == 40, "keys are hashed and stored as bytes");
+
+
+  // solutions of puzzles solved before with one dictionary, so a repeated puzzle is a lookup
+  // instead of a cull and solve. the most recently used results are kept in memory. with a
+  // store path every added result is also appended to the store file, and later caches map
+  // the file and read results from it in place.
+  // solutions index the words of the cache's dictionary, not of the culled copy they were
+  // found on. find and add may be called from any thread. caches of the same store in other
+  // processes append to it under a lock file next to it.
+  class ResultCache {
+  public:
+    BNG_DECL_NO_COPY(ResultCache);
+
+    static constexpr uint32_t kDefaultCapacity = 64;
+
+    // wordDB must outlive the cache. an empty store_path keeps results in memory only.
+    // a store of another dictionary is replaced on the first add.
+    ResultCache(const WordDB& wordDB, const std::filesystem::path& store_path, uint32_t capacity = kDefaultCapacity);
+
+    // the solutions of key, in the order they were added. false if key was never added.
+    bool find(const PuzzleKey& key, SolutionSet& solutions);
+
+    // remembers the solutions of key found on solvedDB, the cache's dictionary culled for key's
+    // puzzle. returns them indexing the cache's dictionary, the same as find does.
+    SolutionSet add(const PuzzleKey& key, const WordDB& solvedDB, const SolutionSet& solutions);
+
+    // results in the store when it was opened.
+    uint32_t stored_count() const {
+      return stored_result_count;
+    }
+
+  private:
+    struct Entry {
+      PuzzleKey key;
+      uint64_t hash = 0;
+      uint64_t last_used = 0;
+      std::unique_ptr<Solution[]> solutions;
+      uint32_t solution_count = 0;
+    };
+
+    // a result in the mapped store. sorted by hash.
+    struct StoredResult {
+      uint64_t hash = 0;
+      uint64_t offset = 0;
+    };
+
+    void open_store();
+
+    // the record of key in the mapped store, nullptr if it has none.
+    const uint8_t* find_stored(const PuzzleKey& key, uint64_t hash) const;
+
+    // into the least recently used entry.
+    void remember(const PuzzleKey& key, uint64_t hash, const Solution* solutions, uint32_t solution_count);
+
+    void append(const PuzzleKey& key, const Solution* solutions, uint32_t solution_count);
+
+  private:
+    const WordDB& wordDB;
+    std::string store_path;
+    // locked by every process opening or appending to the store.
+    std::string lock_path;
+    std::mutex mutex;
+    uint64_t use_count = 0;
+
+    std::unique_ptr<Entry[]> entries;
+    uint32_t capacity = 0;
+    uint32_t entry_count = 0;
+
+    core::MappedFile store;
+    std::unique_ptr<StoredResult[]> stored_results;
+    uint32_t stored_result_count = 0;
+    // end of the last whole record. appends start here.
+    uint64_t store_end = 0;
+    // a torn record that couldn't be cut off would take the results appended after it with it.
+    bool is_store_read_only = false;
+  };
+} // namespace bng::word_db
@@ -0,0 +1,178 @@
+#include "solve_kernel.h"
+#include "kernel_isa.h"
+#include "word_db.h"
+#include <algorithm>
+
+namespace bng::word_db {
+  namespace kernel {
+    namespace {
+      uint32_t match_scalar(const uint32_t* masks, uint32_t count, uint32_t a_mask, uint32_t all_letters, uint32_t* out) {
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+          // unconditional store, only advance on a hit.
+          out[n] = i;
+          n += uint32_t((a_mask | masks[i]) == all_letters);
+        }
+        return n;
+      }
+
+#if defined(BNG_KERNEL_X86)
+      // lane indices of the set bits of each 8 bit compare mask, in order.
+      struct CompressLut {
+        alignas(32) uint32_t lanes[256][8] = {};
+
+        constexpr CompressLut() {
+          for (uint32_t bits = 0; bits < 256; ++bits) {
+            uint32_t n = 0;
+            for (uint32_t lane = 0; lane < 8; ++lane) {
+              if (bits & (1u << lane)) {
+                lanes[bits][n++] = lane;
+              }
+            }
+          }
+        }
+      };
+
+      constexpr CompressLut compress_lut;
+
+      BNG_TARGET_AVX2
+      uint32_t match_avx2(const uint32_t* masks, uint32_t count, uint32_t a_mask, uint32_t all_letters, uint32_t* out) {
+        const __m256i va = _mm256_set1_epi32(int(a_mask));
+        const __m256i vall = _mm256_set1_epi32(int(all_letters));
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < count; i += 8) {
+          const __m256i vb = _mm256_loadu_si256((const __m256i*)(masks + i));
+          const __m256i hit = _mm256_cmpeq_epi32(_mm256_or_si256(va, vb), vall);
+          const auto bits = uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(hit)));
+          if (!bits) {
+            continue;
+          }
+          // no compress-store in avx2. permute via lut and store all 8 lanes,
+          // only the first popcount(bits) are kept.
+          const __m256i lanes = _mm256_load_si256((const __m256i*)compress_lut.lanes[bits]);
+          _mm256_storeu_si256((__m256i*)(out + n), _mm256_add_epi32(lanes, _mm256_set1_epi32(int(i))));
+          n += uint32_t(_mm_popcnt_u32(bits));
+        }
+        return n;
+      }
+
+      BNG_TARGET_AVX512
+      uint32_t match_avx512(const uint32_t* masks, uint32_t count, uint32_t a_mask, uint32_t all_letters, uint32_t* out) {
+        const __m512i va = _mm512_set1_epi32(int(a_mask));
+        const __m512i vall = _mm512_set1_epi32(int(all_letters));
+        const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < count; i += 16) {
+          const __m512i vb = _mm512_loadu_si512((const void*)(masks + i));
+          const __mmask16 hit = _mm512_cmpeq_epi32_mask(_mm512_or_si512(va, vb), vall);
+          if (!hit) {
+            continue;
+          }
+          _mm512_mask_compressstoreu_epi32(out + n, hit, _mm512_add_epi32(lanes, _mm512_set1_epi32(int(i))));
+          n += uint32_t(_mm_popcnt_u32(hit));
+        }
+        return n;
+      }
+
+      bool cpu_has(Isa isa) {
+# if defined(BNG_IS_MSVC)
+        int regs[4] = {};
+        __cpuid(regs, 0);
+        if (regs[0] < 7) {
+          return false;
+        }
+        __cpuid(regs, 1);
+        const bool os_avx = (regs[2] & (1 << 27)) && ((_xgetbv(0) & 0x6) == 0x6);
+        if (!os_avx) {
+          return false;
+        }
+        __cpuidex(regs, 7, 0);
+        switch (isa) {
+        case Isa::scalar: return true;
+        case Isa::avx2: return !!(regs[1] & (1 << 5));
+        case Isa::avx512: return !!(regs[1] & (1 << 16)) && ((_xgetbv(0) & 0xe6) == 0xe6);
+        }
+        return false;
+# else
+        __builtin_cpu_init();
+        switch (isa) {
+        case Isa::scalar: return true;
+        case Isa::avx2: return __builtin_cpu_supports("avx2");
+        case Isa::avx512: return __builtin_cpu_supports("avx512f");
+        }
+        return false;
+# endif
+      }
+#else
+      bool cpu_has(Isa isa) {
+        return isa == Isa::scalar;
+      }
+#endif
+    } // namespace
+
+    Isa best_isa() {
+      static const Isa isa =
+        cpu_has(Isa::avx512) ? Isa::avx512 :
+        cpu_has(Isa::avx2) ? Isa::avx2 :
+        Isa::scalar;
+      return isa;
+    }
+
+    bool is_supported(Isa isa) {
+      return cpu_has(isa);
+    }
+
+    const char* isa_name(Isa isa) {
+      static const char* names[] = { "scalar", "avx2", "avx512" };
+      return (isa <= Isa::avx512) ? names[uint32_t(isa)] : "ER";
+    }
+
+    MatchFn match_fn(Isa isa) {
+      if (!is_supported(isa)) {
+        return nullptr;
+      }
+      switch (isa) {
+      case Isa::scalar: return match_scalar;
+#if defined(BNG_KERNEL_X86)
+      case Isa::avx2: return match_avx2;
+      case Isa::avx512: return match_avx512;
+#else
+      default: break;
+#endif
+      }
+      return nullptr;
+    }
+  }
+
+
+  //
+  // LetterMaskRows
+  //
+
+  LetterMaskRows::LetterMaskRows(const WordDB& db) {
+    uint32_t total = 0;
+    for (uint32_t li = 0; li < 26; ++li) {
+      const uint32_t count = db.row_size(li);
+      row_offsets[li] = total;
+      row_counts[li] = count;
+      _max_padded_count = std::max(_max_padded_count, padded_count(count));
+      total += padded_count(count);
+    }
+
+    if (!total) {
+      return;
+    }
+
+    masks_buf = new uint32_t[total];
+    for (uint32_t li = 0; li < 26; ++li) {
+      uint32_t* mp = masks_buf + row_offsets[li];
+      if (row_counts[li]) {
+        memcpy(mp, db.row_letter_masks(li), sizeof(uint32_t) * row_counts[li]);
+        mp += row_counts[li];
+      }
+      for (uint32_t* me = masks_buf + row_offsets[li] + padded_count(row_counts[li]); mp < me; ++mp) {
+        *mp = kPadMask;
+      }
+    }
+  }
+} // namespace bng::word_db
@@ -0,0 +1,83 @@
+#pragma once
+#include "core/core.h"
+
+namespace bng::word_db {
+  using namespace core;
+
+
+  class WordDB;
+
+
+  namespace kernel {
+    enum class Isa : uint32_t { scalar, avx2, avx512 };
+
+    // writes the index of every mask where (a_mask | masks[i]) == all_letters to out.
+    // masks must be padded to a multiple of LetterMaskRows::kPadCount.
+    // out must have room for count + LetterMaskRows::kPadCount indices.
+    // returns the number of indices written.
+    using MatchFn = uint32_t(*)(const uint32_t* masks, uint32_t count, uint32_t a_mask, uint32_t all_letters, uint32_t* out);
+
+    // widest instruction set supported by the cpu we're running on.
+    Isa best_isa();
+
+    bool is_supported(Isa isa);
+
+    const char* isa_name(Isa isa);
+
+    // nullptr if isa is not supported.
+    MatchFn match_fn(Isa isa);
+
+    inline MatchFn match_fn() {
+      static const MatchFn fn = match_fn(best_isa());
+      return fn;
+    }
+  }
+
+
+  // per first letter rows of 32 bit letter masks, contiguous and padded
+  // so the match kernels can test a full vector of B candidates at a time.
+  // mask i of row li belongs to word first_word(li) + i.
+  class LetterMaskRows {
+  public:
+    BNG_DECL_NO_COPY_IMPL_MOVE(LetterMaskRows);
+
+    static constexpr uint32_t kPadCount = 16;
+    // outside of the 26 letter bits so a padding mask can never complete a puzzle.
+    static constexpr uint32_t kPadMask = 0x80000000u;
+
+    LetterMaskRows() = default;
+
+    explicit LetterMaskRows(const WordDB& db);
+
+    ~LetterMaskRows() {
+      delete[] masks_buf;
+      masks_buf = nullptr;
+    }
+
+    const uint32_t* row(uint32_t letter_i) const {
+      BNG_VERIFY(letter_i < 26, "invalid letter index");
+      return masks_buf + row_offsets[letter_i];
+    }
+
+    // live words in row, not including padding.
+    uint32_t row_count(uint32_t letter_i) const {
+      BNG_VERIFY(letter_i < 26, "invalid letter index");
+      return row_counts[letter_i];
+    }
+
+    // largest padded row. sizes the out buffer for kernel::MatchFn.
+    uint32_t max_padded_count() const {
+      return _max_padded_count;
+    }
+
+    static uint32_t padded_count(uint32_t count) {
+      return (count + kPadCount - 1) & ~(kPadCount - 1);
+    }
+
+  private:
+    uint32_t* masks_buf = nullptr;
+    uint32_t row_offsets[26] = {};
+    uint32_t row_counts[26] = {};
+    uint32_t _max_padded_count = 0;
+  };
+} // namespace bng::word_db
@@ -0,0 +1,249 @@
+#include "complement_index.h"
+#include <algorithm>
+
+namespace bng::word_db {
+  //
+  // ChainSet
+  //
+
+  void ChainSet::grow() {
+    const uint32_t new_capacity = _capacity ? _capacity * 2 : 64;
+    auto new_buf = new Chain[new_capacity];
+    for (uint32_t i = 0; i < _size; ++i) {
+      new_buf[i] = buf[i];
+    }
+    delete[] buf;
+    buf = new_buf;
+    _capacity = new_capacity;
+  }
+
+  void ChainSet::sort(const WordDB& wordDB) {
+    auto total_length = [&wordDB](const Chain& c) {
+      uint32_t len = 0;
+      for (uint32_t i = 0; i < c.count; ++i) {
+        len += uint32_t(wordDB.word(c.words[i])->length);
+      }
+      return len;
+    };
+    std::sort(
+      begin(),
+      end(),
+      [&total_length](auto& lhs, auto& rhs) -> bool {
+        const auto lhs_length = total_length(lhs);
+        const auto rhs_length = total_length(rhs);
+        if (lhs_length != rhs_length) {
+          return lhs_length < rhs_length;
+        }
+        return std::lexicographical_compare(lhs.words, lhs.words + lhs.count, rhs.words, rhs.words + rhs.count);
+      }
+    );
+  }
+
+
+  //
+  // ChainSearch
+  //
+
+  namespace {
+    // the search works on puzzle local letters so a covered letter mask fits in 12 bits.
+    constexpr uint32_t kMaskCount = kLocalMaskCount;
+    constexpr uint32_t kFullMask = kLocalFullMask;
+
+    // words with the same first letter, last letter and letter mask
+    // are interchangeable as far as the search is concerned.
+    struct ChainClass {
+      uint32_t mask = 0;
+      uint32_t last = 0;
+      uint32_t words_begin = 0;
+      uint32_t words_end = 0;
+    };
+
+    class ChainSearch {
+    public:
+      ChainSearch(const WordDB& db, uint32_t all_letters);
+
+      void run(uint32_t max_words, ChainSet& chains);
+
+    private:
+      bool search(uint32_t last, uint32_t covered, uint32_t words_left);
+
+      void emit(uint32_t path_count);
+
+      void emit_words(Chain& chain, uint32_t path_i, uint32_t path_count);
+
+    private:
+      // class_words are grouped by class, classes are grouped by first letter.
+      std::unique_ptr<WordIdx[]> class_words;
+      std::unique_ptr<ChainClass[]> classes;
+      uint32_t row_begin[kPuzzleLetterCount + 1] = {};
+      // any class in row l with a mask that is a superset of m.
+      std::unique_ptr<bool[]> has_superset;
+      // bit k set: (last letter l, covered mask m) can't be completed in k more words.
+      std::unique_ptr<uint8_t[]> dead_states;
+      uint32_t path[Chain::kMaxWords] = {};
+      uint32_t cur_depth = 0;
+      ChainSet* out = nullptr;
+    };
+
+    ChainSearch::ChainSearch(const WordDB& db, uint32_t all_letters) {
+      const auto alphabet = PuzzleAlphabet(all_letters);
+
+      // sort words into classes by (first, last, mask)
+      struct KeyedWord {
+        uint32_t key;
+        WordIdx wi;
+      };
+      uint32_t word_count = 0;
+      for (uint32_t li = 0; li < 26; ++li) {
+        if ((all_letters & (1u << li)) && db.first_word(li)) {
+          word_count += uint32_t(db.last_word(li) - db.first_word(li)) + 1;
+        }
+      }
+      auto keyed = std::make_unique<KeyedWord[]>(word_count);
+      uint32_t keyed_count = 0;
+      for (uint32_t li = 0; li < 26; ++li) {
+        if (!(all_letters & (1u << li))) {
+          continue;
+        }
+        for (auto wp = db.first_word(li); wp && *wp; ++wp) {
+          if (!alphabet.contains(uint32_t(wp->letters))) {
+            continue;
+          }
+          const uint32_t first = alphabet.local_letter(li);
+          const uint32_t last = alphabet.local_letter(db.last_letter_idx(*wp));
+          const uint32_t key = (first << 16) | (last << 12) | alphabet.local_mask(uint32_t(wp->letters));
+          keyed[keyed_count++] = KeyedWord{ key, db.word_i(*wp) };
+        }
+      }
+      std::sort(keyed.get(), keyed.get() + keyed_count,
+        [](const KeyedWord& lhs, const KeyedWord& rhs) { return lhs.key < rhs.key; });
+
+      class_words = std::make_unique<WordIdx[]>(keyed_count);
+      classes = std::make_unique<ChainClass[]>(keyed_count);
+      uint32_t class_count = 0;
+      for (uint32_t i = 0; i < keyed_count; ++i) {
+        class_words[i] = keyed[i].wi;
+        const uint32_t key = keyed[i].key;
+        if (i && key == keyed[i - 1].key) {
+          ++classes[class_count - 1].words_end;
+          continue;
+        }
+        const uint32_t first = key >> 16;
+        for (uint32_t r = first + 1; r <= kPuzzleLetterCount; ++r) {
+          row_begin[r] = class_count + 1;
+        }
+        classes[class_count++] = ChainClass{ key & kFullMask, (key >> 12) & 0xf, i, i + 1 };
+      }
+
+      // sum over supersets: has_superset[l][m] for every m that is a subset of some class mask in row l.
+      has_superset = std::make_unique<bool[]>(kPuzzleLetterCount * kMaskCount);
+      for (uint32_t l = 0; l < kPuzzleLetterCount; ++l) {
+        bool* row_sup = has_superset.get() + l * kMaskCount;
+        for (uint32_t ci = row_begin[l]; ci < row_begin[l + 1]; ++ci) {
+          row_sup[classes[ci].mask] = true;
+        }
+        sum_over_supersets(row_sup, [](bool lhs, bool rhs) { return lhs || rhs; });
+      }
+
+      dead_states = std::make_unique<uint8_t[]>(kPuzzleLetterCount * kMaskCount);
+    }
+
+    void ChainSearch::run(uint32_t max_words, ChainSet& chains) {
+      out = &chains;
+      // iterative deepening. the first depth with any chain is the shortest.
+      for (uint32_t depth = 1; depth <= max_words && !chains.size(); ++depth) {
+        for (uint32_t ci = 0; ci < row_begin[kPuzzleLetterCount]; ++ci) {
+          path[0] = ci;
+          cur_depth = 1;
+          const auto& c = classes[ci];
+          if (depth == 1) {
+            if (c.mask == kFullMask) {
+              emit(1);
+            }
+          }
+          else {
+            search(c.last, c.mask, depth - 1);
+          }
+        }
+      }
+      out = nullptr;
+    }
+
+    bool ChainSearch::search(uint32_t last, uint32_t covered, uint32_t words_left) {
+      const uint32_t state = last * kMaskCount + covered;
+      const auto dead_bit = uint8_t(1u << words_left);
+      if (dead_states[state] & dead_bit) {
+        return false;
+      }
+
+      const uint32_t need = kFullMask & ~covered;
+
+      bool found = false;
+      if (words_left == 1) {
+        // last word has to supply every uncovered letter.
+        if (has_superset[last * kMaskCount + need]) {
+          for (uint32_t ci = row_begin[last]; ci < row_begin[last + 1]; ++ci) {
+            if ((classes[ci].mask & need) == need) {
+              path[cur_depth] = ci;
+              emit(cur_depth + 1);
+              found = true;
+            }
+          }
+        }
+      }
+      else {
+        for (uint32_t ci = row_begin[last]; ci < row_begin[last + 1]; ++ci) {
+          const auto& c = classes[ci];
+          path[cur_depth] = ci;
+          ++cur_depth;
+          found = search(c.last, covered | c.mask, words_left - 1) || found;
+          --cur_depth;
+        }
+      }
+
+      if (!found) {
+        dead_states[state] |= dead_bit;
+      }
+      return found;
+    }
+
+    void ChainSearch::emit(uint32_t path_count) {
+      Chain chain;
+      chain.count = path_count;
+      emit_words(chain, 0, path_count);
+    }
+
+    // every combination of the words in the path's classes is a chain.
+    void ChainSearch::emit_words(Chain& chain, uint32_t path_i, uint32_t path_count) {
+      if (path_i == path_count) {
+        out->add(chain);
+        return;
+      }
+      const auto& c = classes[path[path_i]];
+      for (uint32_t wi = c.words_begin; wi < c.words_end; ++wi) {
+        chain.words[path_i] = class_words[wi];
+        emit_words(chain, path_i + 1, path_count);
+      }
+    }
+  } // namespace
+
+
+  //
+  // WordDB solve_n
+  //
+
+  ChainSet WordDB::solve_n(const SideSet& sides, uint32_t max_words) const {
+    auto _trace = BNG_TRACE_SCOPE("solve_n");
+    auto _timer = BNG_TIMED_SCOPE("solve_n");
+    ChainSet chains;
+    const uint32_t all_letters = puzzle_letters(sides);
+    if (!all_letters) {
+      return chains;
+    }
+
+    max_words = std::min(max_words, Chain::kMaxWords);
+    auto chain_search = ChainSearch(*this, all_letters);
+    chain_search.run(max_words, chains);
+    return chains;
+  }
+} // namespace bng::word_db
@@ -0,0 +1,184 @@
+#include "word_db.h"
+#include "solve_kernel.h"
+#include <algorithm>
+
+namespace bng::word_db {
+  //
+  // SolutionScorer
+  //
+
+  SolutionScorer SolutionScorer::total_length() {
+    SolutionScorer scorer;
+    scorer.score = [](const WordDB&, const Word& a, const Word& b, const void*) {
+      return uint32_t(a.length + b.length);
+    };
+    scorer.bound = [](const WordDB&, const Word& a, uint32_t min_b_length, const void*) {
+      return uint32_t(a.length) + min_b_length;
+    };
+    return scorer;
+  }
+
+
+  //
+  // WordDB::solve_top_k
+  //
+
+  namespace {
+    struct ScoredSolution {
+      uint32_t score = 0;
+      Solution solution;
+    };
+
+    // by score, then word indices, so every solution has a distinct rank.
+    bool is_better(const ScoredSolution& lhs, const ScoredSolution& rhs) {
+      if (lhs.score != rhs.score) {
+        return lhs.score < rhs.score;
+      }
+      if (lhs.solution.a != rhs.solution.a) {
+        return lhs.solution.a < rhs.solution.a;
+      }
+      return lhs.solution.b < rhs.solution.b;
+    }
+
+    // a candidateA and the lowest score it can reach.
+    struct BoundedWord {
+      uint32_t bound = 0;
+      WordIdx a = WordIdx::kInvalid;
+      // letter index of the row of its candidateB words.
+      uint8_t b_letter_i = 0;
+    };
+
+    // a row of candidateB letter masks and where its words start.
+    struct CandidateRow {
+      const uint32_t* masks = nullptr;
+      uint32_t count = 0;
+      uint32_t first_word_i = 0;
+    };
+  } // namespace
+
+  SolutionSet WordDB::solve_top_k(const SideSet& sides, uint32_t k, const SolutionScorer& scorer) const {
+    auto _trace = BNG_TRACE_SCOPE("solve_top_k");
+    auto _timer = BNG_TIMED_SCOPE("solve_top_k");
+    BNG_VERIFY(scorer.score, "scorer has no score function");
+    const uint32_t all_letters = puzzle_letters(sides);
+    if (!all_letters || !k) {
+      return SolutionSet();
+    }
+
+    const auto mask_rows = LetterMaskRows(*this);
+    auto hits = std::make_unique<uint32_t[]>(mask_rows.max_padded_count() + LetterMaskRows::kPadCount);
+    const auto match = kernel::match_fn();
+
+    // the shortest candidateB of each row and all the letters its words have.
+    uint32_t min_b_length[26] = {};
+    uint32_t row_letters[26] = {};
+    for (uint32_t li = 0; li < 26; ++li) {
+      min_b_length[li] = ~0u;
+      for (auto wp = first_word(li); wp && *wp; ++wp) {
+        min_b_length[li] = std::min(min_b_length[li], uint32_t(wp->length));
+      }
+      const uint32_t* masks = row_letter_masks(li);
+      for (uint32_t ri = 0, row_end = row_size(li); ri < row_end; ++ri) {
+        row_letters[li] |= masks[ri];
+      }
+    }
+
+    // candidateA words whose row of candidateB words has all their missing letters, in word order.
+    auto unsorted = std::make_unique<BoundedWord[]>(words_count());
+    uint32_t candidate_count = 0;
+    uint32_t min_bound = ~0u;
+    uint32_t max_bound = 0;
+    for (uint32_t li = 0; li < 26; ++li) {
+      if (!(all_letters & (1u << li)) || !first_word(li)) {
+        continue;
+      }
+      // most words are rejected on their letter and last letter columns, without their Word.
+      const auto row_begin = uint32_t(words_by_letter[li]);
+      for (uint32_t wi = row_begin, row_end = row_begin + row_size(li); wi < row_end; ++wi) {
+        const uint32_t bli = last_letters_buf[wi];
+        const uint32_t letters = letter_masks_buf[wi];
+        if ((letters | row_letters[bli]) != all_letters) {
+          continue;
+        }
+        // candidateB starts with the last letter of candidateA and has every letter it is missing.
+        const Word* wp = words_buf + wi;
+        const uint32_t missing_count = 12 - count_bits(letters & all_letters);
+        const uint32_t b_length = std::max(min_b_length[bli], missing_count + 1);
+        const uint32_t bound = scorer.bound ? scorer.bound(*this, *wp, b_length, scorer.context) : 0;
+        unsorted[candidate_count++] = BoundedWord{ bound, WordIdx(wi), uint8_t(bli) };
+        min_bound = std::min(min_bound, bound);
+        max_bound = std::max(max_bound, bound);
+      }
+    }
+
+    // best bound first, ties in word order. bounds usually span a few word lengths,
+    // so a counting sort does it in one pass.
+    auto candidates = std::make_unique<BoundedWord[]>(candidate_count);
+    const uint32_t kMaxCountingRange = 4096;
+    if (candidate_count && max_bound - min_bound < kMaxCountingRange) {
+      auto bound_begin = std::make_unique<uint32_t[]>(max_bound - min_bound + 2);
+      for (uint32_t ci = 0; ci < candidate_count; ++ci) {
+        ++bound_begin[unsorted[ci].bound - min_bound + 1];
+      }
+      for (uint32_t bi = 1; bi <= max_bound - min_bound; ++bi) {
+        bound_begin[bi] += bound_begin[bi - 1];
+      }
+      for (uint32_t ci = 0; ci < candidate_count; ++ci) {
+        candidates[bound_begin[unsorted[ci].bound - min_bound]++] = unsorted[ci];
+      }
+    }
+    else {
+      std::copy(unsorted.get(), unsorted.get() + candidate_count, candidates.get());
+      std::stable_sort(candidates.get(), candidates.get() + candidate_count,
+        [](const BoundedWord& lhs, const BoundedWord& rhs) {
+          return lhs.bound < rhs.bound;
+        });
+    }
+
+    // looked up by every candidateA, so the rows are only checked once.
+    std::array<CandidateRow, 26> b_rows;
+    for (uint32_t li = 0; li < 26; ++li) {
+      b_rows[li] = CandidateRow{ mask_rows.row(li), mask_rows.row_count(li), uint32_t(words_by_letter[li]) };
+    }
+
+    // max heap on rank, so the worst kept solution is on top.
+    auto heap = std::make_unique<ScoredSolution[]>(k);
+    uint32_t heap_size = 0;
+    for (uint32_t ci = 0; ci < candidate_count; ++ci) {
+      const auto& candidate = candidates[ci];
+      // the best this candidateA can do is its bound with the first candidateB. every
+      // candidateA after it does no better, so a full heap that beats it is final.
+      if (heap_size == k && is_better(heap[0], ScoredSolution{ candidate.bound, { candidate.a, WordIdx(0) } })) {
+        break;
+      }
+
+      const auto& wa = *word(candidate.a);
+      const auto& b_row = b_rows[candidate.b_letter_i];
+      const auto hit_count = match(
+        b_row.masks, LetterMaskRows::padded_count(b_row.count),
+        uint32_t(wa.letters), all_letters, hits.get());
+      const auto wib_first = b_row.first_word_i;
+      for (uint32_t hi = 0; hi < hit_count; ++hi) {
+        const auto wib = WordIdx(wib_first + hits[hi]);
+        const auto scored = ScoredSolution{
+          scorer.score(*this, wa, *word(wib), scorer.context), { candidate.a, wib } };
+        if (heap_size < k) {
+          heap[heap_size++] = scored;
+          std::push_heap(heap.get(), heap.get() + heap_size, is_better);
+        }
+        else if (is_better(scored, heap[0])) {
+          std::pop_heap(heap.get(), heap.get() + heap_size, is_better);
+          heap[heap_size - 1] = scored;
+          std::push_heap(heap.get(), heap.get() + heap_size, is_better);
+        }
+      }
+    }
+
+    std::sort_heap(heap.get(), heap.get() + heap_size, is_better);
+    SolutionSet solutions(heap_size);
+    for (uint32_t i = 0; i < heap_size; ++i) {
+      solutions.add(heap[i].solution.a, heap[i].solution.b);
+    }
+    return solutions;
+  }
+} // namespace bng::word_db
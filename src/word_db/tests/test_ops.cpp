@@ -1,5 +1,11 @@
 #include "word_db.h"
+#include "word_classes.h"
+#include "result_cache.h"
 #include "test_harness/test_harness.h"
+#include "test_rand.h"
+#include <algorithm>
+#include <string>
+#include <vector>
 
 using namespace bng::word_db;
 
@@ -42,6 +48,61 @@ void write_word_list() {
 	fwrite(dict_text, sizeof(dict_text) - 1, 1, word_list);
 }
 
+// every word of the db in row order.
+static std::vector<std::string> words_of(const WordDB& db) {
+	std::vector<std::string> words;
+	for (uint32_t li = 0; li < 26; ++li) {
+		for (auto wp = db.first_word(li); wp && *wp; ++wp) {
+			words.emplace_back(db.str(*wp), size_t(wp->length));
+		}
+	}
+	return words;
+}
+
+// count random words over a-l, each letter from a side of abc, def, ghi, jkl other than
+// the one before. min_length to min_length + length_range - 1 letters long.
+static std::vector<std::string> side_words(TestRand& rand, uint32_t count, uint32_t min_length, uint32_t length_range) {
+	std::vector<std::string> words;
+	for (uint32_t wi = 0; wi < count; ++wi) {
+		std::string w(1, char('a' + rand.next() % 12));
+		for (uint32_t length = min_length + rand.next() % length_range; w.size() < length; ) {
+			const uint32_t side = uint32_t(w.back() - 'a') / 3;
+			const uint32_t other = rand.next() % 9;
+			w += char('a' + (other < side * 3 ? other : other + 3));
+		}
+		words.push_back(w);
+	}
+	return words;
+}
+
+// one word per line.
+static void write_words(const char* path, const std::vector<std::string>& words) {
+	File word_list(path, "w");
+	assert(word_list);
+	for (const auto& w : words) {
+		fprintf(word_list, "%s\n", w.c_str());
+	}
+}
+
+// the letter mask and last letter columns agree with every word and its text.
+static bool columns_match(const WordDB& db) {
+	for (uint32_t li = 0; li < 26; ++li) {
+		const uint32_t* masks = db.row_letter_masks(li);
+		uint32_t ri = 0;
+		for (auto wp = db.first_word(li); wp && *wp; ++wp, ++ri) {
+			const char* text = db.str(*wp);
+			if (masks[ri] != uint32_t(wp->letters) || db.letter_mask(db.word_i(*wp)) != masks[ri] ||
+				db.last_letter_idx(*wp) != Word::letter_to_idx(text[wp->length - 1])) {
+				return false;
+			}
+		}
+		if (ri != db.row_size(li)) {
+			return false;
+		}
+	}
+	return true;
+}
+
 BNG_BEGIN_TEST(dict_counts) {
 	TextBuf db(sizeof(dict_text) - 1);
 	memcpy(db.end(), dict_text, sizeof(dict_text) - 1);
@@ -147,7 +208,6 @@ BNG_BEGIN_TEST(load_and_solve) {
 	{
 		WordDB db;
 		BT_CHECK(db.load("words.pre"));
-		(void)unlink("words.pre");
 
 		for (uint32_t i = 0; i < 26; ++i) {
 			if (db.get_text_stats().word_counts[i]) {
@@ -185,11 +245,12 @@ BNG_BEGIN_TEST(load_and_solve) {
 		// and that they are sufficient to solve the puzzle
 		{
 			const uint32_t live_count = db.get_text_stats().total_count();
-			// 3 less than the 33 in the dictionary. culled:
+			// 2 less than the 33 in the dictionary. culled:
 			// s - too short
 			// heehaw - double letter
-			// supercalifragilisticexpialidocious - more than 12 unique letters
-			BT_CHECK(live_count == 30);
+			// supercalifragilisticexpialidocious has 15 unique letters, so only a
+			// bigger board than this one can play it.
+			BT_CHECK(live_count == 31);
 
 			uint32_t live_letters = 0;
 			for (uint32_t i = 0, li = 0; li < live_count; ++i) {
@@ -200,7 +261,7 @@ BNG_BEGIN_TEST(load_and_solve) {
 				BT_CHECK(!w.is_dead);
 				live_letters |= uint32_t(w.letters);
 				++li;
-				// printf("%.*s\n", uint32_t(w.length), db.get_text_buf().ptr(w));
+				// printf("%.*s\n", uint32_t(w.length), db.str(w));
 			}
 
 			const auto puzzle_letters = uint32_t(sides[0].letters | sides[1].letters | sides[2].letters | sides[3].letters);
@@ -222,8 +283,960 @@ BNG_BEGIN_TEST(load_and_solve) {
 		BT_CHECK(!strncmp(sa, "bearskin", a.length));
 		BT_CHECK(!strncmp(sb, "nematode", a.length));
 	}
+	// the loaded db maps the file, so it can only go once the db is gone.
+	(void)unlink("words.pre");
+	unlink("word_list.txt");
+}
+
+BNG_END_TEST()
+
+BNG_BEGIN_TEST(pre_file_checks) {
+	write_word_list();
+	{
+		WordDB db("word_list.txt");
+		BT_CHECK(db.get_fingerprint() != 0);
+		db.save("words.pre");
+
+		WordDB db2("words.pre");
+		BT_CHECK(db2 && db.is_equivalent(db2));
+		BT_CHECK(db2.get_fingerprint() == db.get_fingerprint());
+	}
+	{
+		// flip the last text byte. the checksum catches it and the file is ignored.
+		File pre("words.pre", "r+b");
+		BT_CHECK(pre);
+		const auto size = pre.size_bytes();
+		char c = 0;
+		fseek(pre, long(size - 3), SEEK_SET);
+		BT_CHECK(fread(&c, 1, 1, pre) == 1);
+		c ^= 1;
+		fseek(pre, long(size - 3), SEEK_SET);
+		BT_CHECK(fwrite(&c, 1, 1, pre) == 1);
+	}
+	{
+		WordDB db;
+		BT_CHECK(!db.load("words.pre"));
+	}
+	{
+		// pre-versioned files have no magic.
+		File pre("words.pre", "wb");
+		fwrite(dict_text, sizeof(dict_text) - 1, 1, pre);
+	}
+	{
+		WordDB db;
+		BT_CHECK(!db.load("words.pre"));
+	}
+	(void)unlink("words.pre");
+	unlink("word_list.txt");
+}
+BNG_END_TEST()
+
+BNG_BEGIN_TEST(pre_image_view) {
+	write_word_list();
+	{
+		WordDB db("word_list.txt");
+		db.save("words.pre");
+
+		File pre("words.pre", "rb");
+		BT_CHECK(pre);
+		const auto size = pre.size_bytes();
+		auto image = std::make_unique<uint64_t[]>((size + 7) / 8);
+		BT_CHECK(fread(image.get(), 1, size, pre) == size);
+		const auto image_bytes = reinterpret_cast<const uint8_t*>(image.get());
+		const auto image_copy = std::make_unique<uint8_t[]>(size);
+		memcpy(image_copy.get(), image_bytes, size);
+
+		WordDB view = WordDB::view(image_bytes, size);
+		BT_CHECK(view && view.is_equivalent(db));
+		BT_CHECK(view.get_fingerprint() == db.get_fingerprint());
+
+		// misaligned or truncated images are rejected.
+		BT_CHECK(!WordDB::view(image_bytes + 1, size - 1));
+		BT_CHECK(!WordDB::view(image_bytes, size / 2));
+
+		// culling a view makes a packed copy and leaves the image untouched.
+		WordDB::SideSet sides;
+		for (uint32_t i = 0; i < 4; ++i) {
+			sides[i] = Word(puzzle_sides[i]);
+		}
+		db.cull(sides);
+		view.cull(sides);
+		BT_CHECK(view.is_equivalent(db));
+		BT_CHECK(!memcmp(image_copy.get(), image_bytes, size));
+		BT_CHECK(view.solve(sides).size() == db.solve(sides).size());
+	}
+	(void)unlink("words.pre");
+	unlink("word_list.txt");
+}
+BNG_END_TEST()
+
+BNG_BEGIN_TEST(threaded_cull_and_solve) {
+	write_word_list();
+	{
+		WordDB::SideSet sides = {
+			Word(puzzle_sides[0]),
+			Word(puzzle_sides[1]),
+			Word(puzzle_sides[2]),
+			Word(puzzle_sides[3])
+		};
+
+		WordDB db("word_list.txt");
+		WordDB db_mt("word_list.txt");
+		BT_CHECK(db && db_mt);
+
+		db.cull(sides);
+		db_mt.cull(sides, 4);
+		BT_CHECK(db.is_equivalent(db_mt));
+
+		SolutionSet solutions = db.solve(sides);
+		SolutionSet solutions_mt = db_mt.solve(sides, 4);
+		BT_CHECK(solutions.size() == 1);
+		BT_CHECK(solutions_mt.size() == solutions.size());
+		BT_CHECK(solutions_mt.front().a == solutions.front().a);
+		BT_CHECK(solutions_mt.front().b == solutions.front().b);
+	}
+	unlink("word_list.txt");
+}
+BNG_END_TEST()
+
+BNG_BEGIN_TEST(threaded_preprocess) {
+	// big enough to split into many text chunks. no words start with q.
+	uint32_t word_count = 0;
+	{
+		File word_list("big_word_list.txt", "w");
+		assert(word_list);
+		for (uint32_t li = 0; li < 26; ++li) {
+			if (li == 'q' - 'a') {
+				continue;
+			}
+			for (uint32_t n = 0; n < 4000; ++n, ++word_count) {
+				char w[8] = { char('a' + li) };
+				uint32_t len = 1;
+				for (uint32_t v = n; len == 1 || v; v /= 26) {
+					w[len++] = char('a' + v % 26);
+				}
+				fprintf(word_list, "%s\n", w);
+			}
+		}
+	}
+	{
+		WordDB db("big_word_list.txt");
+		WordDB db_mt("big_word_list.txt", 4);
+		BT_CHECK(db && db_mt);
+		BT_CHECK(db.is_equivalent(db_mt));
+		BT_CHECK(db.get_fingerprint() == db_mt.get_fingerprint());
+		BT_CHECK(!db_mt.first_word('q' - 'a'));
+
+		// only words with a doubled letter or shorter than 3 are dropped.
+		uint32_t expected_count = 0;
+		bool rows_ok = true;
+		for (uint32_t li = 0; li < 26; ++li) {
+			for (auto wp = db_mt.first_word(li); wp && *wp; ++wp) {
+				rows_ok = rows_ok && db_mt.first_letter_idx(*wp) == li;
+				++expected_count;
+			}
+		}
+		BT_CHECK(rows_ok);
+		BT_CHECK(db_mt.size() == expected_count);
+		BT_CHECK(expected_count < word_count && expected_count > word_count / 2);
+	}
+	unlink("big_word_list.txt");
+}
+BNG_END_TEST()
+
+BNG_BEGIN_TEST(solve_n_chains) {
+	WordDB::SideSet sides = {
+		Word(puzzle_sides[0]),
+		Word(puzzle_sides[1]),
+		Word(puzzle_sides[2]),
+		Word(puzzle_sides[3])
+	};
+
+	write_word_list();
+	{
+		WordDB db("word_list.txt");
+		db.cull(sides);
+		// the shortest chain is the two word solution.
+		ChainSet chains = db.solve_n(sides, 5);
+		BT_CHECK(chains.size() == 1);
+		BT_CHECK(chains.word_count() == 2);
+		const auto& chain = *chains.begin();
+		BT_CHECK(!strncmp(db.str(*db.word(chain.words[0])), "bearskin", 8));
+		BT_CHECK(!strncmp(db.str(*db.word(chain.words[1])), "nematode", 8));
+	}
+	{
+		// chains of the same total length sort by word indices in chain order.
+		WordDB db("word_list.txt");
+		const auto cat = db.find_word("cat", 3);
+		const auto dog = db.find_word("dog", 3);
+		const auto fit = db.find_word("fit", 3);
+		BT_CHECK(cat < dog && dog < fit);
+		ChainSet chains;
+		chains.add(Chain{ { fit, cat }, 2 });
+		chains.add(Chain{ { dog, fit }, 2 });
+		chains.add(Chain{ { cat, fit }, 2 });
+		chains.add(Chain{ { dog, cat }, 2 });
+		chains.sort(db);
+		const WordIdx expected[][2] = { { cat, fit }, { dog, cat }, { dog, fit }, { fit, cat } };
+		bool is_ordered = true;
+		for (uint32_t i = 0; i < 4; ++i) {
+			is_ordered = is_ordered && chains.begin()[i].words[0] == expected[i][0] && chains.begin()[i].words[1] == expected[i][1];
+		}
+		BT_CHECK(is_ordered);
+	}
+	unlink("word_list.txt");
+
+	// no two word solution, only bat -> tokens -> smardi.
+	// every other word uses a letter that is not in the puzzle.
+	{
+		File chain_list("chain_list.txt", "w");
+		assert(chain_list);
+		const char chain_text[] =
+			"axe\nbat\ncat\ndux\nexo\nfig\ngum\nhug\nivy\njug\nkex\nlux\nmux\n"
+			"nix\noxy\npug\nqua\nrex\nsmardi\ntokens\ntux\nugh\nvex\nwax\nxyz\nyak\nzax\n";
+		fwrite(chain_text, sizeof(chain_text) - 1, 1, chain_list);
+	}
+	{
+		WordDB db("chain_list.txt");
+		BT_CHECK(db);
+		db.cull(sides);
+		BT_CHECK(db.solve(sides).size() == 0);
+		BT_CHECK(db.solve_n(sides, 2).size() == 0);
+
+		ChainSet chains = db.solve_n(sides, 4);
+		BT_CHECK(chains.size() == 1);
+		BT_CHECK(chains.word_count() == 3);
+		const char* expected[] = { "bat", "tokens", "smardi" };
+		for (uint32_t i = 0; i < 3; ++i) {
+			const auto& w = *db.word(chains.begin()->words[i]);
+			BT_CHECK(w.length == strlen(expected[i]) && !strncmp(db.str(w), expected[i], w.length));
+		}
+	}
+	unlink("chain_list.txt");
+}
+BNG_END_TEST()
+
+BNG_BEGIN_TEST(culled_copy) {
+	write_word_list();
+	{
+		WordDB::SideSet sides = {
+			Word(puzzle_sides[0]),
+			Word(puzzle_sides[1]),
+			Word(puzzle_sides[2]),
+			Word(puzzle_sides[3])
+		};
+
+		WordDB db("word_list.txt");
+		WordDB db_loaded("word_list.txt");
+		WordDB db_culled("word_list.txt");
+		db_culled.cull(sides);
+
+		// culled() matches cull() and leaves the source alone.
+		WordDB db_copy = db.culled(sides);
+		BT_CHECK(db_copy.is_equivalent(db_culled));
+		BT_CHECK(db.is_equivalent(db_loaded));
+		BT_CHECK(db_copy.solve(sides).size() == 1);
+	}
 	unlink("word_list.txt");
 }
+BNG_END_TEST()
+
+BNG_BEGIN_TEST(letter_columns) {
+	write_word_list();
+	{
+		WordDB::SideSet sides;
+		for (uint32_t i = 0; i < 4; ++i) {
+			sides[i] = Word(puzzle_sides[i]);
+		}
+
+		WordDB db("word_list.txt");
+		BT_CHECK(columns_match(db));
+		BT_CHECK(db.row_size(Word::letter_to_idx('a')) == 2 && db.row_size(Word::letter_to_idx('z')) == 3);
+		BT_CHECK(columns_match(db.culled(sides)));
+
+		// saved with the db and read back in place.
+		db.save("columns.pre");
+		WordDB db_pre("columns.pre");
+		BT_CHECK(db_pre && columns_match(db_pre));
+
+		db.cull(sides, 2);
+		BT_CHECK(columns_match(db));
+		BT_CHECK(db.row_size(Word::letter_to_idx('z')) == 0 && !db.row_letter_masks(Word::letter_to_idx('z')));
+	}
+	(void)unlink("columns.pre");
+	unlink("word_list.txt");
+}
+BNG_END_TEST()
+
+BNG_BEGIN_TEST(huge_page_storage) {
+	// enough words for an arena of more than one huge page. every word is playable, so
+	// the culled copies are as large.
+	TestRand rand{ 0x3c6ef372u };
+	write_words("huge_page_word_list.txt", side_words(rand, 150000, 3, 7));
+	{
+		const char* sides_str[] = { "abc", "def", "ghi", "jkl" };
+		WordDB::SideSet sides;
+		for (uint32_t i = 0; i < 4; ++i) {
+			sides[i] = Word(sides_str[i]);
+		}
+
+		WordDB db("huge_page_word_list.txt");
+		WordDB db_huge;
+		db_huge.set_use_huge_pages(true);
+		BT_CHECK(db_huge.load("huge_page_word_list.txt"));
+		BT_CHECK(db_huge.is_equivalent(db));
+		BT_CHECK(!db.is_huge_page_aligned());
+		// words start the arena, which starts on a cache line.
+		BT_CHECK(!(uintptr_t(db.word(WordIdx(0))) & (PageBuf::kAlign - 1)));
+#if !defined(BNG_IS_WINDOWS)
+		BT_CHECK(db_huge.is_huge_page_aligned());
+		BT_CHECK(!(uintptr_t(db_huge.word(WordIdx(0))) & (PageBuf::kHugePageSize - 1)));
+#endif
+
+		// culled copies keep the storage of the db they came from.
+		WordDB db_culled = db.culled(sides);
+		WordDB db_huge_culled = db_huge.culled(sides);
+		BT_CHECK(db_huge_culled.is_equivalent(db_culled));
+		BT_CHECK(db_huge_culled.is_huge_page_aligned() == db_huge.is_huge_page_aligned());
+		db_huge.cull(sides);
+		BT_CHECK(db_huge.is_equivalent(db_culled));
+		BT_CHECK(db_huge.solve(sides).size() == db_culled.solve(sides).size());
+
+		// moving hands over the arena.
+		const bool is_huge = db_huge.is_huge_page_aligned();
+		WordDB db_moved = std::move(db_huge);
+		BT_CHECK(!db_huge && db_moved.is_equivalent(db_culled));
+		BT_CHECK(db_moved.is_huge_page_aligned() == is_huge);
+	}
+	unlink("huge_page_word_list.txt");
+}
+BNG_END_TEST()
+
+BNG_BEGIN_TEST(class_index_solve) {
+	WordDB::SideSet sides = {
+		Word(puzzle_sides[0]),
+		Word(puzzle_sides[1]),
+		Word(puzzle_sides[2]),
+		Word(puzzle_sides[3])
+	};
+
+	write_word_list();
+	{
+		WordDB db("word_list.txt");
+		WordDB db_classes("word_list.txt");
+		BT_CHECK(db && db_classes);
 
+		db_classes.build_class_index();
+		db.cull(sides);
+		db_classes.cull(sides);
+		// the index follows the db through cull.
+		BT_CHECK(db_classes.get_class_index() != nullptr);
+		BT_CHECK(db_classes.get_class_index()->word_count() == db_classes.size());
+		BT_CHECK(db_classes.get_class_index()->class_count() <= db_classes.get_class_index()->word_count());
+
+		SolutionSet solutions = db.solve(sides);
+		SolutionSet solutions_classes = db_classes.solve(sides);
+		BT_CHECK(solutions_classes.size() == solutions.size());
+		BT_CHECK(db.count_solutions(sides) == solutions.size());
+		BT_CHECK(db_classes.count_solutions(sides) == solutions.size());
+		BT_CHECK(solutions_classes.front().a == solutions.front().a);
+		BT_CHECK(solutions_classes.front().b == solutions.front().b);
+	}
+	unlink("word_list.txt");
+}
 BNG_END_TEST()
 
+BNG_BEGIN_TEST(complement_solve) {
+	WordDB::SideSet sides = {
+		Word(puzzle_sides[0]),
+		Word(puzzle_sides[1]),
+		Word(puzzle_sides[2]),
+		Word(puzzle_sides[3])
+	};
+
+	write_word_list();
+	{
+		WordDB db("word_list.txt");
+		BT_CHECK(db);
+
+		// unculled words outside the puzzle are skipped by the index.
+		SolutionSet solutions_unculled = db.solve_complement(sides);
+		db.cull(sides);
+		SolutionSet solutions = db.solve(sides);
+		SolutionSet solutions_complement = db.solve_complement(sides);
+		BT_CHECK(solutions_complement.size() == solutions.size());
+		BT_CHECK(solutions_unculled.size() == solutions.size());
+		BT_CHECK(solutions_complement.front().a == solutions.front().a);
+		BT_CHECK(solutions_complement.front().b == solutions.front().b);
+	}
+	unlink("word_list.txt");
+}
+BNG_END_TEST()
+
+BNG_BEGIN_TEST(segmented_text) {
+	// every word alternates sides, so all of them survive culling.
+	// enough words for rows to straddle segment boundaries.
+	const char* sides_str[] = { "abc", "def", "ghi", "jkl" };
+	std::vector<std::string> expected;
+	for (uint32_t length = 3; length <= 5; ++length) {
+		uint32_t combo_count = 12;
+		for (uint32_t i = 1; i < length; ++i) {
+			combo_count *= 9;
+		}
+		for (uint32_t combo = 0; combo < combo_count; ++combo) {
+			std::string w(1, char('a' + combo % 12));
+			for (uint32_t v = combo / 12; w.size() < length; v /= 9) {
+				// the 9 letters on the other sides.
+				const uint32_t side = uint32_t(w.back() - 'a') / 3;
+				const uint32_t other = v % 9;
+				w += char('a' + (other < side * 3 ? other : other + 3));
+			}
+			expected.push_back(w);
+		}
+	}
+	std::sort(expected.begin(), expected.end());
+	{
+		File word_list("segmented_word_list.txt", "w");
+		assert(word_list);
+		for (const auto& w : expected) {
+			fprintf(word_list, "%s\n", w.c_str());
+		}
+	}
+
+	{
+		WordDB::SideSet sides;
+		for (uint32_t i = 0; i < 4; ++i) {
+			sides[i] = Word(sides_str[i]);
+		}
+
+		WordDB db("segmented_word_list.txt");
+		WordDB db_mt("segmented_word_list.txt", 4);
+		BT_CHECK(db.size() == expected.size() && db.size() > WordDB::kSegmentWords);
+		BT_CHECK(words_of(db) == expected);
+		BT_CHECK(db.is_equivalent(db_mt));
+
+		db.save("segmented.pre");
+		WordDB db_pre("segmented.pre");
+		BT_CHECK(db_pre && db_pre.is_equivalent(db));
+		BT_CHECK(words_of(db_pre) == expected);
+
+		// packed copies rebase the words ahead of each row's first segment.
+		WordDB db_copy = db_pre.culled(sides);
+		db.cull(sides);
+		db_mt.cull(sides, 4);
+		BT_CHECK(words_of(db) == expected);
+		BT_CHECK(db.is_equivalent(db_mt));
+		BT_CHECK(db.is_equivalent(db_copy));
+	}
+	(void)unlink("segmented.pre");
+	unlink("segmented_word_list.txt");
+}
+BNG_END_TEST()
+
+BNG_BEGIN_TEST(unsorted_word_lists) {
+	// more than one text chunk of words, shuffled, duplicated and in mixed case.
+	std::vector<std::string> words;
+	for (uint32_t li = 0; li < 26; ++li) {
+		for (uint32_t n = 0; n < 1500; ++n) {
+			std::string w(1, char('a' + li));
+			for (uint32_t v = n * 7 + li; w.size() < 3 || v; v /= 26) {
+				w += char('a' + v % 26);
+			}
+			words.push_back(w);
+		}
+		// long words that only differ past the first 16 letters.
+		for (uint32_t n = 0; n < 100; ++n) {
+			std::string w = std::string(1, char('a' + li)) + "rstrstrstrstrst";
+			for (uint32_t v = n; v; v /= 3) {
+				w += char('a' + v % 3);
+				w += 'x';
+			}
+			words.push_back(w);
+		}
+	}
+	std::vector<std::string> sorted = words;
+	std::sort(sorted.begin(), sorted.end());
+	sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+	TestRand rand{ 0x9e3779b9u };
+	for (size_t i = words.size(); i > 1; --i) {
+		std::swap(words[i - 1], words[rand.next() % i]);
+	}
+
+	const char* delims[] = { "\n", "\r\n", " ", "\t" };
+	const char* list_names[] = { "unsorted_0.txt", "unsorted_1.txt", "unsorted_2.txt" };
+	{
+		File sorted_list("sorted_word_list.txt", "w");
+		File messy_list("unsorted_word_list.txt", "w");
+		File parts[3] = { File(list_names[0], "w"), File(list_names[1], "w"), File(list_names[2], "w") };
+		assert(sorted_list && messy_list && parts[0] && parts[1] && parts[2]);
+		for (const auto& w : sorted) {
+			fprintf(sorted_list, "%s\n", w.c_str());
+		}
+		for (size_t i = 0; i < words.size(); ++i) {
+			std::string w = words[i];
+			for (auto& c : w) {
+				c = (rand.next() % 4) ? c : char(c - 'a' + 'A');
+			}
+			const auto delim = delims[rand.next() % 4];
+			fprintf(messy_list, "%s%s", w.c_str(), delim);
+			if (i % 3 == 0) {
+				fprintf(messy_list, "%s%s", w.c_str(), delim);
+			}
+			// every word in one part and some in two.
+			fprintf(parts[i % 3], "%s\n", w.c_str());
+			if (i % 5 == 0) {
+				fprintf(parts[(i + 1) % 3], "%s\n", w.c_str());
+			}
+		}
+	}
+
+	{
+		WordDB db("sorted_word_list.txt");
+		WordDB db_messy("unsorted_word_list.txt");
+		WordDB db_messy_mt("unsorted_word_list.txt", 4);
+		BT_CHECK(db && db_messy && db_messy_mt);
+		BT_CHECK(db.is_equivalent(db_messy));
+		BT_CHECK(db.is_equivalent(db_messy_mt));
+		BT_CHECK(db.get_fingerprint() != db_messy.get_fingerprint());
+
+		// the live words in order and no duplicates.
+		const auto db_words = words_of(db_messy);
+		BT_CHECK(std::adjacent_find(db_words.begin(), db_words.end(),
+			[](const auto& lhs, const auto& rhs) { return lhs >= rhs; }) == db_words.end());
+		BT_CHECK(db_words.size() == db.size() && db_words.size() > sorted.size() / 2);
+
+		const std::filesystem::path paths[] = { list_names[0], list_names[1], list_names[2] };
+		WordDB db_merged(paths, 4);
+		BT_CHECK(db_merged && db.is_equivalent(db_merged));
+		WordDB db_one(std::span(paths, 1));
+		WordDB db_part(paths[0]);
+		BT_CHECK(db_one && db_one.is_equivalent(db_part));
+		BT_CHECK(db_one.get_fingerprint() == db_part.get_fingerprint());
+		BT_CHECK(db_merged.get_fingerprint() != db_one.get_fingerprint());
+	}
+	unlink("sorted_word_list.txt");
+	unlink("unsorted_word_list.txt");
+	for (auto name : list_names) {
+		unlink(name);
+	}
+}
+BNG_END_TEST()
+
+BNG_BEGIN_TEST(top_k_solve) {
+	// random words that alternate sides, long enough for many solutions.
+	const char* sides_str[] = { "abc", "def", "ghi", "jkl" };
+	TestRand rand{ 0x2545f491u };
+	write_words("top_k_word_list.txt", side_words(rand, 3000, 3, 7));
+
+	{
+		WordDB::SideSet sides;
+		for (uint32_t i = 0; i < 4; ++i) {
+			sides[i] = Word(sides_str[i]);
+		}
+		WordDB db("top_k_word_list.txt");
+		BT_CHECK(db);
+		db.cull(sides);
+
+		// every solution, ranked the way solve_top_k ranks them.
+		auto rank_all = [&db, &sides](const SolutionScorer& scorer) {
+			SolutionSet all = db.solve_complement(sides);
+			std::vector<Solution> ranked(all.begin(), all.end());
+			auto score = [&](const Solution& s) {
+				return scorer.score(db, *db.word(s.a), *db.word(s.b), scorer.context);
+			};
+			std::sort(ranked.begin(), ranked.end(), [&](const Solution& lhs, const Solution& rhs) {
+				const auto ls = score(lhs);
+				const auto rs = score(rhs);
+				return ls != rs ? ls < rs : (lhs.a != rhs.a ? lhs.a < rhs.a : lhs.b < rhs.b);
+			});
+			return ranked;
+		};
+		auto is_prefix = [](const SolutionSet& top, const std::vector<Solution>& ranked, size_t k) {
+			bool same = top.size() == std::min(k, ranked.size());
+			for (size_t i = 0; same && i < top.size(); ++i) {
+				same = top.begin()[i].a == ranked[i].a && top.begin()[i].b == ranked[i].b;
+			}
+			return same;
+		};
+
+		const auto by_length = rank_all(SolutionScorer::total_length());
+		BT_CHECK(by_length.size() > 1000);
+		const uint32_t ks[] = { 1, 10, 100, 100000 };
+		for (auto k : ks) {
+			BT_CHECK(is_prefix(db.solve_top_k(sides, k), by_length, k));
+		}
+
+		// most letters first, with a loose bound and with none.
+		SolutionScorer longest;
+		longest.score = [](const WordDB&, const Word& a, const Word& b, const void*) {
+			return uint32_t(128 - a.length - b.length);
+		};
+		longest.bound = [](const WordDB&, const Word& a, uint32_t, const void*) {
+			return uint32_t(128 - a.length - 63);
+		};
+		const auto by_longest = rank_all(longest);
+		BT_CHECK(is_prefix(db.solve_top_k(sides, 10, longest), by_longest, 10));
+		longest.bound = nullptr;
+		BT_CHECK(is_prefix(db.solve_top_k(sides, 10, longest), by_longest, 10));
+		BT_CHECK(db.solve_top_k(sides, 0).size() == 0);
+	}
+	unlink("top_k_word_list.txt");
+}
+BNG_END_TEST()
+
+BNG_BEGIN_TEST(solve_past_half_size) {
+	// few words with many solutions each. solve used to size its output for
+	// at most one solution per two words.
+	const char* sides_str[] = { "abc", "def", "ghi", "jkl" };
+	TestRand rand{ 0x9e3779b9u };
+	write_words("half_size_word_list.txt", side_words(rand, 1500, 6, 6));
+
+	{
+		WordDB::SideSet sides;
+		for (uint32_t i = 0; i < 4; ++i) {
+			sides[i] = Word(sides_str[i]);
+		}
+		WordDB db("half_size_word_list.txt");
+		BT_CHECK(db);
+		db.cull(sides);
+
+		// SolutionSet::sort only orders by length, so compare in word order.
+		auto sorted = [](const SolutionSet& solutions) {
+			std::vector<Solution> sorted_solutions(solutions.begin(), solutions.end());
+			std::sort(sorted_solutions.begin(), sorted_solutions.end(), [](const Solution& lhs, const Solution& rhs) {
+				return lhs.a != rhs.a ? lhs.a < rhs.a : lhs.b < rhs.b;
+			});
+			return sorted_solutions;
+		};
+		auto same = [](const std::vector<Solution>& lhs, const std::vector<Solution>& rhs) {
+			bool is_same = lhs.size() == rhs.size();
+			for (size_t i = 0; is_same && i < lhs.size(); ++i) {
+				is_same = lhs[i].a == rhs[i].a && lhs[i].b == rhs[i].b;
+			}
+			return is_same;
+		};
+
+		const auto expected = sorted(db.solve_complement(sides));
+		BT_CHECK(expected.size() > db.size() / 2);
+		BT_CHECK(expected.size() > SolutionBlocks::kBlockSize * 2);
+		BT_CHECK(db.count_solutions(sides) == expected.size());
+		BT_CHECK(same(sorted(db.solve(sides)), expected));
+		BT_CHECK(same(sorted(db.solve(sides, 3)), expected));
+
+		// sort orders by total length, then word order, however the solutions were found.
+		auto by_length = [&db](SolutionSet solutions) {
+			solutions.sort(db);
+			return std::vector<Solution>(solutions.begin(), solutions.end());
+		};
+		const auto sorted_by_length = by_length(db.solve(sides));
+		bool is_ordered = true;
+		for (size_t i = 1; i < sorted_by_length.size(); ++i) {
+			const auto& lhs = sorted_by_length[i - 1];
+			const auto& rhs = sorted_by_length[i];
+			const uint32_t lhs_length = db.word(lhs.a)->length + db.word(lhs.b)->length;
+			const uint32_t rhs_length = db.word(rhs.a)->length + db.word(rhs.b)->length;
+			is_ordered = is_ordered && (lhs_length != rhs_length ? lhs_length < rhs_length :
+				(lhs.a != rhs.a ? lhs.a < rhs.a : lhs.b < rhs.b));
+		}
+		BT_CHECK(is_ordered);
+		BT_CHECK(same(by_length(db.solve(sides, 3)), sorted_by_length));
+		BT_CHECK(same(by_length(db.solve_complement(sides)), sorted_by_length));
+	}
+	unlink("half_size_word_list.txt");
+}
+BNG_END_TEST()
+
+BNG_BEGIN_TEST(solve_stats) {
+	// words over a-l alternating the sides they were made for, solved on other sides
+	// so cull rejects words for both reasons. every 10th word has a letter in no puzzle.
+	TestRand rand{ 0x6b43a9b5u };
+	auto words = side_words(rand, 2000, 3, 7);
+	for (size_t wi = 0; wi < words.size(); wi += 10) {
+		words[wi] += 'x';
+	}
+	write_words("stats_word_list.txt", words);
+
+	{
+		const char* sides_str[] = { "abd", "ceg", "fhi", "jkl" };
+		WordDB::SideSet sides;
+		for (uint32_t i = 0; i < 4; ++i) {
+			sides[i] = Word(sides_str[i]);
+		}
+		auto is_same = [](const SolveStats& lhs, const SolveStats& rhs) {
+			return !memcmp(&lhs, &rhs, sizeof(SolveStats));
+		};
+
+		const WordDB db("stats_word_list.txt");
+		BT_CHECK(db);
+		SolveStats culled_stats;
+		const WordDB culledDB = db.culled(sides, &culled_stats);
+		SolveStats solve_stats;
+		const auto solutions = culledDB.solve(sides, 1, &solve_stats);
+		BT_CHECK(solutions.size() > 0);
+
+		WordDB culled1("stats_word_list.txt");
+		SolveStats cull1_stats;
+		culled1.cull(sides, 1, &cull1_stats);
+		WordDB culled3("stats_word_list.txt");
+		SolveStats cull3_stats;
+		culled3.cull(sides, 3, &cull3_stats);
+		SolveStats solve3_stats;
+		culled3.solve(sides, 3, &solve3_stats);
+
+		if (SolveStats::kIsEnabled) {
+			BT_CHECK(culled_stats.foreign_letter_rejects > 0 && culled_stats.same_side_rejects > 0);
+			BT_CHECK(db.size() == culledDB.size() + culled_stats.foreign_letter_rejects + culled_stats.same_side_rejects);
+			BT_CHECK(culled_stats.words_tested <= db.size());
+			BT_CHECK(is_same(cull1_stats, culled_stats));
+			BT_CHECK(is_same(cull3_stats, culled_stats));
+
+			BT_CHECK(solve_stats.hit_count() == solutions.size());
+			BT_CHECK(solve_stats.candidates_a > 0 && solve_stats.candidates_a <= culledDB.size());
+			BT_CHECK(solve_stats.pairs_compared >= solve_stats.hit_count());
+			BT_CHECK(is_same(solve3_stats, solve_stats));
+		}
+		else {
+			BT_CHECK(is_same(culled_stats, SolveStats()));
+			BT_CHECK(is_same(cull3_stats, SolveStats()));
+			BT_CHECK(is_same(solve_stats, SolveStats()));
+			BT_CHECK(is_same(solve3_stats, SolveStats()));
+		}
+	}
+	unlink("stats_word_list.txt");
+}
+BNG_END_TEST()
+
+// solutions of sides found word pair by word pair, straight from the rules.
+template<typename Sides>
+static std::vector<std::string> brute_force_solutions(const std::vector<std::string>& words, const Sides& sides) {
+	uint32_t side_of[26] = {};
+	uint32_t all_letters = 0;
+	for (uint32_t si = 0; si < Sides::kSideCount; ++si) {
+		for (uint32_t li = 0; li < 26; ++li) {
+			if (sides[si].letters & (1u << li)) {
+				side_of[li] = si + 1;
+				all_letters |= 1u << li;
+			}
+		}
+	}
+	std::vector<std::string> playable;
+	std::vector<uint32_t> masks;
+	std::vector<std::string> unique_words = words;
+	std::sort(unique_words.begin(), unique_words.end());
+	unique_words.erase(std::unique(unique_words.begin(), unique_words.end()), unique_words.end());
+	for (const auto& w : unique_words) {
+		bool is_playable = w.size() >= 3;
+		uint32_t mask = 0;
+		for (size_t i = 0; is_playable && i < w.size(); ++i) {
+			const auto li = Word::letter_to_idx(w[i]);
+			is_playable = side_of[li] && (!i || side_of[li] != side_of[Word::letter_to_idx(w[i - 1])]);
+			mask |= 1u << li;
+		}
+		if (is_playable) {
+			playable.push_back(w);
+			masks.push_back(mask);
+		}
+	}
+	std::vector<std::string> solutions;
+	for (size_t a = 0; a < playable.size(); ++a) {
+		for (size_t b = 0; b < playable.size(); ++b) {
+			if (playable[a].back() == playable[b].front() && (masks[a] | masks[b]) == all_letters) {
+				solutions.push_back(playable[a] + " " + playable[b]);
+			}
+		}
+	}
+	std::sort(solutions.begin(), solutions.end());
+	return solutions;
+}
+
+template<typename Sides>
+static bool solves_like_brute_force(const char* const* sides_str, uint32_t word_count) {
+	Sides sides;
+	std::string letters;
+	for (uint32_t si = 0; si < Sides::kSideCount; ++si) {
+		sides[si] = Word(sides_str[si]);
+		letters += sides_str[si];
+	}
+	// random words over the puzzle letters, some of them unplayable. long words have more
+	// unique letters than a pair signature holds.
+	std::vector<std::string> words;
+	TestRand rand{ 0x2545f491u + Sides::kLetterCount };
+	for (uint32_t i = 0; i < word_count; ++i) {
+		std::string w;
+		const uint32_t length = 3 + rand.next() % 20;
+		for (uint32_t ci = 0, si = 0; ci < length; ++ci) {
+			// mostly playable, each letter from a side other than the one before.
+			si = (si + 1 + rand.next() % (Sides::kSideCount - 1)) % Sides::kSideCount;
+			const auto li = si * Sides::kSideWidth + rand.next() % Sides::kSideWidth;
+			w += (rand.next() % 64) ? letters[li] : letters[rand.next() % letters.size()];
+		}
+		words.push_back(w);
+	}
+	write_words("geometry_word_list.txt", words);
+
+	WordDB db("geometry_word_list.txt");
+	unlink("geometry_word_list.txt");
+	const WordDB culled = db.culled(sides);
+	db.cull(sides);
+	if (!db.is_equivalent(culled)) {
+		return false;
+	}
+	std::vector<std::string> found;
+	for (auto s : db.solve(sides)) {
+		const auto& a = *db.word(s.a);
+		const auto& b = *db.word(s.b);
+		found.push_back(std::string(db.str(a), a.length) + " " + std::string(db.str(b), b.length));
+	}
+	std::sort(found.begin(), found.end());
+	const auto expected = brute_force_solutions(words, sides);
+	return !expected.empty() && found == expected;
+}
+
+BNG_BEGIN_TEST(board_geometries) {
+	const char* sides_3x3[] = { "abc", "def", "ghi" };
+	const char* sides_4x3[] = { "abc", "def", "ghi", "jkl" };
+	const char* sides_6x3[] = { "abc", "def", "ghi", "jkl", "mno", "pqr" };
+	const char* sides_4x4[] = { "abcd", "efgh", "ijkl", "mnop" };
+	const char* sides_6x4[] = { "abcd", "efgh", "ijkl", "mnop", "qrst", "uvwx" };
+	BT_CHECK((solves_like_brute_force<BasicSideSet<3, 3>>(sides_3x3, 3000)));
+	BT_CHECK((solves_like_brute_force<BasicSideSet<4, 3>>(sides_4x3, 3000)));
+	BT_CHECK((solves_like_brute_force<BasicSideSet<6, 3>>(sides_6x3, 3000)));
+	BT_CHECK((solves_like_brute_force<BasicSideSet<4, 4>>(sides_4x4, 3000)));
+	BT_CHECK((solves_like_brute_force<BasicSideSet<6, 4>>(sides_6x4, 3000)));
+
+	// each board checks its own side width and letter count.
+	BasicSideSet<3, 3> short_sides;
+	for (uint32_t si = 0; si < 3; ++si) {
+		short_sides[si] = Word(sides_4x4[si]);
+	}
+	BT_CHECK(!WordDB::puzzle_letters(short_sides));
+	BasicSideSet<4, 4> wide_sides;
+	for (uint32_t si = 0; si < 4; ++si) {
+		wide_sides[si] = Word(sides_4x4[si]);
+	}
+	BT_CHECK(WordDB::puzzle_letters(wide_sides) == 0xffffu);
+}
+BNG_END_TEST()
+
+// "a b" per solution, in set order.
+static std::vector<std::string> solution_strs(const WordDB& db, const SolutionSet& solutions) {
+	std::vector<std::string> strs;
+	for (const auto& s : solutions) {
+		const auto& a = *db.word(s.a);
+		const auto& b = *db.word(s.b);
+		strs.push_back(std::string(db.str(a), a.length) + " " + std::string(db.str(b), b.length));
+	}
+	return strs;
+}
+
+BNG_BEGIN_TEST(result_cache) {
+	WordDB::SideSet sides = {
+		Word(puzzle_sides[0]),
+		Word(puzzle_sides[1]),
+		Word(puzzle_sides[2]),
+		Word(puzzle_sides[3])
+	};
+	// the same puzzle listed another way, and another puzzle of the same letters.
+	WordDB::SideSet shuffled_sides = { Word("rim"), Word("soe"), Word("ntb"), Word("dka") };
+	WordDB::SideSet other_sides = { Word("bta"), Word("nkd"), Word("oes"), Word("mir") };
+
+	const auto canonical = shuffled_sides.canonical();
+	BT_CHECK(canonical[0].letters == Word("adk").letters && canonical[3].letters == Word("imr").letters);
+	for (uint32_t si = 0; si < 4; ++si) {
+		BT_CHECK(!memcmp(&canonical[si], &sides.canonical()[si], sizeof(Word)));
+	}
+
+	write_word_list();
+	unlink("results.cache");
+	{
+		WordDB db("word_list.txt");
+		const auto key = PuzzleKey(sides, db.get_fingerprint());
+		const auto other_key = PuzzleKey(other_sides, db.get_fingerprint());
+		BT_CHECK(key == PuzzleKey(shuffled_sides, db.get_fingerprint()));
+		BT_CHECK(!(key == other_key));
+		BT_CHECK(!(key == PuzzleKey(sides, db.get_fingerprint() + 1)));
+
+		const WordDB culled = db.culled(sides);
+		const auto expected = solution_strs(culled, culled.solve(sides));
+		BT_CHECK(!expected.empty());
+		const WordDB other_culled = db.culled(other_sides);
+
+		{
+			ResultCache cache(db, "results.cache");
+			SolutionSet found;
+			BT_CHECK(!cache.find(key, found));
+			// added solutions index the loaded db, not the culled one.
+			BT_CHECK(solution_strs(db, cache.add(key, culled, culled.solve(sides))) == expected);
+			BT_CHECK(cache.find(PuzzleKey(shuffled_sides, db.get_fingerprint()), found));
+			BT_CHECK(solution_strs(db, found) == expected);
+		}
+		{
+			// later caches read it from the store.
+			ResultCache cache(db, "results.cache");
+			BT_CHECK(cache.stored_count() == 1);
+			SolutionSet found;
+			BT_CHECK(cache.find(key, found));
+			BT_CHECK(solution_strs(db, found) == expected);
+		}
+
+		// an append cut short is dropped, and appends go on after the last whole record.
+		{
+			File store("results.cache", "ab");
+			fwrite("torn", 4, 1, store);
+		}
+		{
+			ResultCache cache(db, "results.cache");
+			BT_CHECK(cache.stored_count() == 1);
+			cache.add(other_key, other_culled, other_culled.solve(other_sides));
+		}
+		{
+			ResultCache cache(db, "results.cache");
+			BT_CHECK(cache.stored_count() == 2);
+			SolutionSet found;
+			BT_CHECK(cache.find(other_key, found));
+			BT_CHECK(solution_strs(db, found) == solution_strs(other_culled, other_culled.solve(other_sides)));
+		}
+
+		// in memory only, the least recently used result goes first.
+		{
+			ResultCache cache(db, "", 1);
+			cache.add(key, culled, culled.solve(sides));
+			cache.add(other_key, other_culled, other_culled.solve(other_sides));
+			SolutionSet found;
+			BT_CHECK(!cache.find(key, found));
+			BT_CHECK(cache.find(other_key, found));
+		}
+	}
+	{
+		// a store of another dictionary is ignored, then replaced.
+		File word_list("other_word_list.txt", "w");
+		fwrite(dict_text, sizeof(dict_text) - 1, 1, word_list);
+		fputs("bank\n", word_list);
+	}
+	{
+		WordDB other_db("other_word_list.txt");
+		const auto key = PuzzleKey(sides, other_db.get_fingerprint());
+		const auto other_key = PuzzleKey(other_sides, other_db.get_fingerprint());
+		const WordDB culled = other_db.culled(sides);
+		const WordDB other_culled = other_db.culled(other_sides);
+		{
+			ResultCache cache(other_db, "results.cache");
+			BT_CHECK(cache.stored_count() == 0);
+			// opened before either adds, like a cache in another process. it appends to the
+			// store the first add wrote instead of replacing it again.
+			ResultCache other_cache(other_db, "results.cache");
+			SolutionSet found;
+			BT_CHECK(!cache.find(key, found));
+			cache.add(key, culled, culled.solve(sides));
+			other_cache.add(other_key, other_culled, other_culled.solve(other_sides));
+		}
+		ResultCache cache(other_db, "results.cache");
+		BT_CHECK(cache.stored_count() == 2);
+	}
+	unlink("results.cache");
+	unlink("results.cache.lock");
+	unlink("other_word_list.txt");
+	unlink("word_list.txt");
+}
+BNG_END_TEST()
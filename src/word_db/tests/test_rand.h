@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdint>
+
+// xorshift32. the same seed makes the same test data on every platform.
+struct TestRand {
+	uint32_t x;
+
+	uint32_t next() {
+		x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+		return x;
+	}
+};
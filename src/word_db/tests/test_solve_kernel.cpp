@@ -0,0 +1,63 @@
+#include "solve_kernel.h"
+#include "test_harness/test_harness.h"
+#include "test_rand.h"
+
+using namespace bng::word_db;
+
+static const uint32_t all_letters = 0x0f0f0fu;
+
+// deterministic masks that are subsets of all_letters, with a few padding masks mixed in.
+static void fill_masks(uint32_t* masks, uint32_t count) {
+	TestRand rand{ 0x12345678u };
+	for (uint32_t i = 0; i < count; ++i) {
+		const uint32_t x = rand.next();
+		masks[i] = (i % 97 == 13) ? LetterMaskRows::kPadMask : (x & all_letters);
+	}
+}
+
+BNG_BEGIN_TEST(isa_dispatch) {
+	BT_CHECK(kernel::is_supported(kernel::Isa::scalar));
+	BT_CHECK(kernel::match_fn(kernel::Isa::scalar) != nullptr);
+	BT_CHECK(kernel::is_supported(kernel::best_isa()));
+	BT_CHECK(kernel::match_fn() == kernel::match_fn(kernel::best_isa()));
+	BT_CHECK(LetterMaskRows::padded_count(0) == 0);
+	BT_CHECK(LetterMaskRows::padded_count(1) == LetterMaskRows::kPadCount);
+	BT_CHECK(LetterMaskRows::padded_count(LetterMaskRows::kPadCount) == LetterMaskRows::kPadCount);
+}
+BNG_END_TEST()
+
+BNG_BEGIN_TEST(isa_match_equivalence) {
+	const uint32_t count = 1024;
+	static uint32_t masks[count];
+	static uint32_t expected[count + LetterMaskRows::kPadCount];
+	static uint32_t actual[count + LetterMaskRows::kPadCount];
+	fill_masks(masks, count);
+
+	const uint32_t a_masks[] = { 0x0f0000u, 0x000f0fu, 0x0a0a0au, all_letters, 0u };
+	const kernel::Isa isas[] = { kernel::Isa::avx2, kernel::Isa::avx512 };
+	const auto scalar = kernel::match_fn(kernel::Isa::scalar);
+
+	for (auto a : a_masks) {
+		const auto expected_count = scalar(masks, count, a, all_letters, expected);
+		BT_CHECK(a == 0u || expected_count > 0);
+		for (uint32_t i = 0; i < expected_count; ++i) {
+			BT_CHECK((a | masks[expected[i]]) == all_letters);
+		}
+
+		for (auto isa : isas) {
+			auto match = kernel::match_fn(isa);
+			if (!match) {
+				printf("%s not supported. skipping.\n", kernel::isa_name(isa));
+				continue;
+			}
+			const auto actual_count = match(masks, count, a, all_letters, actual);
+			BT_CHECK(actual_count == expected_count);
+			bool same = true;
+			for (uint32_t i = 0; i < expected_count && i < actual_count; ++i) {
+				same = same && (actual[i] == expected[i]);
+			}
+			BT_CHECK(same);
+		}
+	}
+}
+BNG_END_TEST()
@@ -0,0 +1,110 @@
+#include "text_kernel.h"
+#include "word_db.h"
+#include "test_harness/test_harness.h"
+#include "test_rand.h"
+#include <string>
+#include <vector>
+
+using namespace bng::word_db;
+
+// deterministic word list with mixed delimiters, doubled letters, words crossing
+// 64 byte block boundaries and words longer than a block.
+static std::string make_text() {
+	std::string text;
+	TestRand rand{ 0x2545f491u };
+	for (uint32_t wi = 0; wi < 3000; ++wi) {
+		const uint32_t x = rand.next();
+		const uint32_t length = (wi % 251 == 7) ? 70 + x % 40 : 1 + x % 14;
+		for (uint32_t i = 0; i < length; ++i) {
+			const uint32_t r = (x >> (i % 24)) + i * 7;
+			// every 5th letter repeats the one before it now and then.
+			text += (i && (r % 5 == 0)) ? text.back() : char('a' + r % 26);
+		}
+		const char* delims[] = { "\n", "\r\n", " ", "\t\n", "-", "\n\n" };
+		text += delims[x % 6];
+	}
+	return text;
+}
+
+BNG_BEGIN_TEST(isa_classify_equivalence) {
+	// classify reads the byte before the text.
+	std::string text(1, ' ');
+	text += make_text();
+	const uint32_t block_count = uint32_t(text.size() - 1) / 64;
+	std::vector<kernel::TextBits> expected(block_count);
+	std::vector<kernel::TextBits> actual(block_count);
+
+	BT_CHECK(kernel::classify_fn(kernel::Isa::scalar) != nullptr);
+	BT_CHECK(kernel::classify_fn() == kernel::classify_fn(kernel::best_isa()));
+	kernel::classify_fn(kernel::Isa::scalar)(text.data() + 1, block_count, expected.data());
+
+	const kernel::Isa isas[] = { kernel::Isa::avx2, kernel::Isa::avx512 };
+	for (auto isa : isas) {
+		auto classify = kernel::classify_fn(isa);
+		if (!classify) {
+			printf("%s not supported. skipping.\n", kernel::isa_name(isa));
+			continue;
+		}
+		classify(text.data() + 1, block_count, actual.data());
+		bool same = true;
+		for (uint32_t bi = 0; bi < block_count; ++bi) {
+			same = same && actual[bi].letters == expected[bi].letters && actual[bi].doubles == expected[bi].doubles;
+		}
+		BT_CHECK(same);
+	}
+}
+BNG_END_TEST()
+
+BNG_BEGIN_TEST(scan_matches_read_str) {
+	const std::string text = make_text();
+
+	// every start offset exercises a different block alignment.
+	for (uint32_t begin = 0; begin < 70; ) {
+		uint32_t expected_count = 0;
+		uint32_t scanned_count = 0;
+		bool same = true;
+		const char* p = text.c_str() + begin;
+		scan_words(text.c_str(), begin, uint32_t(text.size()),
+			[&](const ScannedWord& sw) {
+				Word w;
+				const auto span = w.read_str(text.c_str(), p);
+				const auto sw_word = Word(sw);
+				same = same &&
+					sw.begin == uint32_t(p - text.c_str()) &&
+					sw.span == span &&
+					sw.first_letter == Word::letter_to_idx(*p) &&
+					sw_word.length == w.length &&
+					sw_word.letters == w.letters &&
+					sw_word.letter_count == w.letter_count &&
+					sw_word.is_dead == w.is_dead;
+				p += span;
+				++scanned_count;
+			});
+		for (const char* q = text.c_str() + begin; *q; ++expected_count) {
+			Word w;
+			q += w.read_str(text.c_str(), q);
+		}
+		BT_CHECK(same);
+		BT_CHECK(scanned_count == expected_count);
+
+		// next word start.
+		while (Word::letter_to_bit(text[begin])) {
+			++begin;
+		}
+		while (!Word::letter_to_bit(text[begin])) {
+			++begin;
+		}
+	}
+
+	// a scan of a range stops at its end.
+	uint32_t count = 0;
+	uint32_t span_total = 0;
+	scan_words("abc\nbeef\ncab", 4, 9, [&](const ScannedWord& sw) {
+		++count;
+		span_total += sw.span;
+		BT_CHECK(sw.begin == 4 && sw.length == 4 && sw.has_double);
+		BT_CHECK(sw.letters == (Word::letter_to_bit('b') | Word::letter_to_bit('e') | Word::letter_to_bit('f')));
+	});
+	BT_CHECK(count == 1 && span_total == 5);
+}
+BNG_END_TEST()
@@ -71,7 +71,15 @@ BNG_BEGIN_TEST(test_word) {
 		Word word;
 		word.read_str(txt, txt);
 		BT_CHECK(word.length == 13);
-		// too many unique letters
+		// more unique letters than a 4 x 3 board, but playable on a bigger one
+		BT_CHECK(word.is_dead == 0);
+	}
+	{
+		const char* txt = "abcdefghijklmnopqrstuvwxy";
+		Word word;
+		word.read_str(txt, txt);
+		BT_CHECK(word.length == 25);
+		// too many unique letters for any board
 		BT_CHECK(word.is_dead == 1);
 	}
 	{
@@ -84,3 +92,28 @@ BNG_BEGIN_TEST(test_word) {
 }
 BNG_END_TEST()
 
+
+
+BNG_BEGIN_TEST(test_pair_sig) {
+	{
+		// letter ranks a:0 c:1 e:2 f:3
+		const char* txt = "acefc";
+		Word word(txt);
+		BT_CHECK(word.letter_rank(Word::letter_to_bit('a')) == 0);
+		BT_CHECK(word.letter_rank(Word::letter_to_bit('f')) == 3);
+		BT_CHECK(Word::rank_pair_bit(0, 1) == Word::rank_pair_bit(1, 0));
+		const uint64_t sig = word.pair_sig(txt);
+		BT_CHECK(sig == (Word::rank_pair_bit(0, 1) | Word::rank_pair_bit(1, 2) |
+			Word::rank_pair_bit(2, 3) | Word::rank_pair_bit(3, 1)));
+		BT_CHECK(!(sig & Word::rank_pair_bit(0, 2)));
+	}
+	{
+		// every rank pair of 11 letters fits in the signature. 12 letters don't get one.
+		BT_CHECK(Word::rank_pair_bit(9, 10) == (1ull << 54));
+		const char* txt = "abcdefghijkl";
+		Word word(txt);
+		BT_CHECK(word.letter_count == 12);
+		BT_CHECK(word.pair_sig(txt) == 0);
+	}
+}
+BNG_END_TEST()
@@ -0,0 +1,68 @@
+#include "text_kernel.h"
+#include "kernel_isa.h"
+
+namespace bng::word_db {
+  namespace kernel {
+    namespace {
+      void classify_scalar(const char* text, uint32_t block_count, TextBits* out) {
+        for (uint32_t bi = 0; bi < block_count; ++bi, text += 64) {
+          uint64_t letters = 0;
+          uint64_t doubles = 0;
+          char prev = text[-1];
+          for (uint32_t i = 0; i < 64; ++i) {
+            const auto is_letter = uint64_t(uint32_t(uint8_t(text[i]) - 'a') < 26);
+            letters |= is_letter << i;
+            doubles |= (is_letter & uint64_t(text[i] == prev)) << i;
+            prev = text[i];
+          }
+          out[bi] = TextBits{ letters, doubles };
+        }
+      }
+
+#if defined(BNG_KERNEL_X86)
+      BNG_TARGET_AVX2
+      uint32_t letter_bits_avx2(__m256i v) {
+        // unsigned v - 'a' < 26, as min(x, 25) == x.
+        const __m256i x = _mm256_sub_epi8(v, _mm256_set1_epi8('a'));
+        return uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(25)), x)));
+      }
+
+      BNG_TARGET_AVX2
+      uint32_t equal_bits_avx2(__m256i v, __m256i prev) {
+        return uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, prev)));
+      }
+
+      BNG_TARGET_AVX2
+      void classify_avx2(const char* text, uint32_t block_count, TextBits* out) {
+        for (uint32_t bi = 0; bi < block_count; ++bi, text += 64) {
+          const __m256i lo = _mm256_loadu_si256((const __m256i*)text);
+          const __m256i hi = _mm256_loadu_si256((const __m256i*)(text + 32));
+          // the same bytes shifted by one, to compare each byte with the one before it.
+          const __m256i lo_prev = _mm256_loadu_si256((const __m256i*)(text - 1));
+          const __m256i hi_prev = _mm256_loadu_si256((const __m256i*)(text + 31));
+          const uint64_t letters = uint64_t(letter_bits_avx2(lo)) | (uint64_t(letter_bits_avx2(hi)) << 32);
+          const uint64_t equal = uint64_t(equal_bits_avx2(lo, lo_prev)) | (uint64_t(equal_bits_avx2(hi, hi_prev)) << 32);
+          out[bi] = TextBits{ letters, letters & equal };
+        }
+      }
+#endif
+    } // namespace
+
+    ClassifyFn classify_fn(Isa isa) {
+      if (!is_supported(isa)) {
+        return nullptr;
+      }
+      switch (isa) {
+      case Isa::scalar: return classify_scalar;
+#if defined(BNG_KERNEL_X86)
+      // byte compares at 512 bits need avx512bw. avx2 covers a block in 2 loads.
+      case Isa::avx2: return classify_avx2;
+      case Isa::avx512: return classify_avx2;
+#else
+      default: break;
+#endif
+      }
+      return nullptr;
+    }
+  }
+} // namespace bng::word_db
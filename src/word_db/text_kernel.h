@@ -0,0 +1,150 @@
+#pragma once
+#include "solve_kernel.h"
+
+namespace bng::word_db {
+  namespace kernel {
+    // one 64 byte block of text as bit masks. bit i is byte i of the block.
+    struct TextBits {
+      // a-z
+      uint64_t letters = 0;
+      // a letter equal to the byte before it.
+      uint64_t doubles = 0;
+    };
+
+    // classifies block_count 64 byte blocks of text into out.
+    // the byte before text must be readable.
+    using ClassifyFn = void(*)(const char* text, uint32_t block_count, TextBits* out);
+
+    // nullptr if isa is not supported.
+    ClassifyFn classify_fn(Isa isa);
+
+    inline ClassifyFn classify_fn() {
+      static const ClassifyFn fn = classify_fn(best_isa());
+      return fn;
+    }
+  }
+
+
+  // a word found by scan_words. everything but a-z is a delimiter.
+  struct ScannedWord {
+    // offset in the scanned text.
+    uint32_t begin = 0;
+    // letters in the word.
+    uint32_t length = 0;
+    // length plus the delimiters up to the next word or the end of the scan.
+    uint32_t span = 0;
+    // 26 bit letter mask.
+    uint32_t letters = 0;
+    // 0-25. the row the word goes in.
+    uint32_t first_letter = 0;
+    bool has_double = false;
+
+    uint32_t letter_count() const {
+      return count_bits(letters);
+    }
+  };
+
+
+  // calls fn(const ScannedWord&) for every word of text in [begin, end), in order.
+  // begin must be the start of a word. delimiters are found 64 bytes at a time
+  // with the classify kernel, so there is no per character branching on them.
+  template<typename F>
+  void scan_words(const char* text, uint32_t begin, uint32_t end, F&& fn) {
+    constexpr uint32_t kBlockSize = 64;
+    constexpr uint32_t kBatchBlocks = 64;
+
+    const auto classify = kernel::classify_fn();
+    kernel::TextBits bits[kBatchBlocks];
+    // the previous block, for words crossing a block boundary.
+    kernel::TextBits prev_bits;
+    uint32_t word_begin = 0;
+    bool has_pending = false;
+    ScannedWord pending;
+
+    // a word ends at e. words span at most 2 blocks unless they are longer than 64 letters.
+    auto end_word = [&](uint32_t base, uint32_t e, const kernel::TextBits& block_bits) {
+      pending.begin = word_begin;
+      pending.length = e - word_begin;
+      pending.letters = 0;
+      pending.first_letter = uint32_t(uint8_t(text[word_begin]) - 'a');
+      for (uint32_t i = word_begin; i < e; ++i) {
+        pending.letters |= 1u << uint32_t(uint8_t(text[i]) - 'a');
+      }
+      // the first letter of a word never counts as a double, so bits from before it are fine.
+      const uint32_t cur_from = word_begin > base ? word_begin - base : 0;
+      const uint64_t cur_mask = (e - base == 64) ? ~0ull : ((1ull << (e - base)) - 1);
+      uint64_t doubles = block_bits.doubles & cur_mask & ~((1ull << cur_from) - 1);
+      if (word_begin < base) {
+        if (base - word_begin <= kBlockSize) {
+          doubles |= prev_bits.doubles >> (kBlockSize - (base - word_begin));
+        }
+        else {
+          for (uint32_t i = word_begin + 1; i < base; ++i) {
+            doubles |= uint64_t(text[i] == text[i - 1]);
+          }
+          doubles |= prev_bits.doubles;
+        }
+      }
+      pending.has_double = !!doubles;
+      has_pending = true;
+    };
+
+    auto start_word = [&](uint32_t s) {
+      if (has_pending) {
+        pending.span = s - pending.begin;
+        fn(pending);
+        has_pending = false;
+      }
+      word_begin = s;
+    };
+
+    bool in_word = false;
+    for (uint32_t base = begin; base < end; ) {
+      uint32_t block_count = 0;
+      const uint32_t remaining = end - base;
+      if (base == begin || remaining < kBlockSize) {
+        // there may be no readable byte before the first block and the last block is partial.
+        // both are classified from a zero padded copy.
+        alignas(64) char padded[kBlockSize * 2] = {};
+        const uint32_t size = remaining < kBlockSize ? remaining : kBlockSize;
+        padded[kBlockSize - 1] = (base > begin) ? text[base - 1] : 0;
+        memcpy(padded + kBlockSize, text + base, size);
+        classify(padded + kBlockSize, 1, bits);
+        block_count = 1;
+      }
+      else {
+        block_count = remaining / kBlockSize < kBatchBlocks ? remaining / kBlockSize : kBatchBlocks;
+        classify(text + base, block_count, bits);
+      }
+
+      for (uint32_t bi = 0; bi < block_count; ++bi, base += kBlockSize) {
+        const auto& block_bits = bits[bi];
+        const uint64_t prev_letters = (block_bits.letters << 1) | uint64_t(in_word);
+        const uint64_t starts = block_bits.letters & ~prev_letters;
+        const uint64_t ends = ~block_bits.letters & prev_letters;
+        for (uint64_t events = starts | ends; events; events &= (events - 1)) {
+          const auto i = uint32_t(std::countr_zero(events));
+          if (starts & (1ull << i)) {
+            start_word(base + i);
+          }
+          else {
+            end_word(base, base + i, block_bits);
+          }
+        }
+        in_word = !!(block_bits.letters >> 63);
+        prev_bits = block_bits;
+      }
+      // the last block may have been partial.
+      base = base < end ? base : end;
+    }
+
+    if (in_word) {
+      // ends exactly on a block boundary at the end of the scan.
+      end_word(end, end, kernel::TextBits{});
+    }
+    if (has_pending) {
+      pending.span = end - pending.begin;
+      fn(pending);
+    }
+  }
+} // namespace bng::word_db
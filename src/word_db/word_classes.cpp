@@ -0,0 +1,107 @@
+#include "word_classes.h"
+#include <algorithm>
+
+namespace bng::word_db {
+  //
+  // WordClassIndex
+  //
+
+  WordClassIndex::WordClassIndex(const WordDB& db) {
+    struct KeyedWord {
+      uint64_t key;
+      WordIdx wi;
+    };
+
+    uint32_t word_count = 0;
+    uint32_t max_row_count = 0;
+    for (uint32_t li = 0; li < 26; ++li) {
+      uint32_t row_count = 0;
+      for (auto wp = db.first_word(li); wp && *wp; ++wp) {
+        ++row_count;
+      }
+      word_count += row_count;
+      max_row_count = std::max(max_row_count, row_count);
+    }
+
+    if (!word_count) {
+      return;
+    }
+
+    // class count is bounded by word count.
+    classes_buf = new WordClass[word_count];
+    words_buf = new WordIdx[word_count];
+    _word_count = word_count;
+    auto keyed = std::make_unique<KeyedWord[]>(max_row_count);
+
+    uint32_t class_count = 0;
+    uint32_t posted_count = 0;
+    for (uint32_t li = 0; li < 26; ++li) {
+      row_begin[li] = class_count;
+
+      uint32_t keyed_count = 0;
+      for (auto wp = db.first_word(li); wp && *wp; ++wp) {
+        const auto key = (uint64_t(db.last_letter_idx(*wp)) << 32) | uint64_t(wp->letters);
+        keyed[keyed_count++] = KeyedWord{ key, db.word_i(*wp) };
+      }
+      // stable so each posting list stays in word order.
+      std::stable_sort(keyed.get(), keyed.get() + keyed_count,
+        [](const KeyedWord& lhs, const KeyedWord& rhs) { return lhs.key < rhs.key; });
+
+      for (uint32_t i = 0; i < keyed_count; ++i) {
+        if (!i || keyed[i].key != keyed[i - 1].key) {
+          classes_buf[class_count++] = WordClass{
+            uint32_t(keyed[i].key), uint32_t(keyed[i].key >> 32), posted_count, posted_count };
+        }
+        words_buf[posted_count++] = keyed[i].wi;
+        ++classes_buf[class_count - 1].words_end;
+      }
+    }
+    row_begin[26] = class_count;
+  }
+
+  uint64_t WordClassIndex::count(uint32_t all_letters) const {
+    uint64_t total = 0;
+    for (uint32_t ali = 0; ali < 26; ++ali) {
+      if (!(all_letters & (1u << ali))) {
+        continue;
+      }
+      for (auto cpa = row_begin_class(ali), cpa_end = row_end_class(ali); cpa < cpa_end; ++cpa) {
+        const auto bli = cpa->last_letter_i;
+        for (auto cpb = row_begin_class(bli), cpb_end = row_end_class(bli); cpb < cpb_end; ++cpb) {
+          if ((cpa->letters | cpb->letters) == all_letters) {
+            total += uint64_t(cpa->word_count()) * cpb->word_count();
+          }
+        }
+      }
+    }
+    return total;
+  }
+
+  SolutionSet WordClassIndex::solve(uint32_t all_letters) const {
+    const uint64_t solution_count = count(all_letters);
+    BNG_VERIFY(solution_count <= ~0u, "too many solutions");
+    SolutionSet solutions{ uint32_t(solution_count) };
+
+    for (uint32_t ali = 0; ali < 26; ++ali) {
+      if (!(all_letters & (1u << ali))) {
+        continue;
+      }
+      for (auto cpa = row_begin_class(ali), cpa_end = row_end_class(ali); cpa < cpa_end; ++cpa) {
+        const auto bli = cpa->last_letter_i;
+        for (auto cpb = row_begin_class(bli), cpb_end = row_end_class(bli); cpb < cpb_end; ++cpb) {
+          if ((cpa->letters | cpb->letters) != all_letters) {
+            continue;
+          }
+          // expand the class pair to word pairs.
+          for (auto wia = class_words(*cpa), wia_end = wia + cpa->word_count(); wia < wia_end; ++wia) {
+            for (auto wib = class_words(*cpb), wib_end = wib + cpb->word_count(); wib < wib_end; ++wib) {
+              solutions.add(*wia, *wib);
+            }
+          }
+        }
+      }
+    }
+
+    return solutions;
+  }
+} // namespace bng::word_db
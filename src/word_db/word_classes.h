@@ -0,0 +1,79 @@
+#pragma once
+#include "word_db.h"
+
+namespace bng::word_db {
+  // words that share first letter, last letter and letter mask are
+  // interchangeable when solving. a class is one such group.
+  struct WordClass {
+    uint32_t letters = 0;
+    uint32_t last_letter_i = 0;
+    // range in WordClassIndex posting list
+    uint32_t words_begin = 0;
+    uint32_t words_end = 0;
+
+    uint32_t word_count() const {
+      return words_end - words_begin;
+    }
+  };
+
+
+  // unique (first letter, last letter, letter mask) classes of a WordDB
+  // with posting lists back to the word indices of that db.
+  class WordClassIndex {
+  public:
+    BNG_DECL_NO_COPY_IMPL_MOVE(WordClassIndex);
+
+    WordClassIndex() = default;
+
+    explicit WordClassIndex(const WordDB& db);
+
+    ~WordClassIndex() {
+      delete[] classes_buf;
+      delete[] words_buf;
+      classes_buf = nullptr;
+      words_buf = nullptr;
+    }
+
+    operator bool() const {
+      return !!classes_buf;
+    }
+
+    bool operator !() const {
+      return !classes_buf;
+    }
+
+    uint32_t class_count() const {
+      return row_begin[26];
+    }
+
+    uint32_t word_count() const {
+      return _word_count;
+    }
+
+    const WordClass* row_begin_class(uint32_t letter_i) const {
+      BNG_VERIFY(letter_i < 26, "invalid letter index");
+      return classes_buf + row_begin[letter_i];
+    }
+
+    const WordClass* row_end_class(uint32_t letter_i) const {
+      BNG_VERIFY(letter_i < 26, "invalid letter index");
+      return classes_buf + row_begin[letter_i + 1];
+    }
+
+    const WordIdx* class_words(const WordClass& c) const {
+      return words_buf + c.words_begin;
+    }
+
+    // number of word pairs completing the puzzle without expanding any class.
+    uint64_t count(uint32_t all_letters) const;
+
+    // class pairs expanded to word pairs.
+    SolutionSet solve(uint32_t all_letters) const;
+
+  private:
+    WordClass* classes_buf = nullptr;
+    WordIdx* words_buf = nullptr;
+    uint32_t row_begin[27] = {};
+    uint32_t _word_count = 0;
+  };
+} // namespace bng::word_db
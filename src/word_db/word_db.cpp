@@ -1,7 +1,35 @@
 #include "word_db.h"
+#include "complement_index.h"
+#include "solve_kernel.h"
+#include "text_kernel.h"
+#include "word_classes.h"
+#include "core/parallel.h"
 #include <algorithm>
 
+// statements that only exist in BNG_SOLVE_STATS builds.
+#if defined(BNG_SOLVE_STATS)
+# define BNG_SOLVE_STAT(...) do { __VA_ARGS__; } while(0)
+#else
+# define BNG_SOLVE_STAT(...) do { } while(0)
+#endif
+
 namespace bng::word_db {
+#if defined(BNG_SOLVE_STATS)
+  namespace {
+    // a word cull tested, and why it was rejected if it was.
+    void count_cull(SolveStats* stats, const Word& word, uint32_t all_letters, bool is_kept) {
+      if (!stats) {
+        return;
+      }
+      ++stats->words_tested;
+      if (!is_kept) {
+        const bool is_foreign = (uint32_t(word.letters) | all_letters) != all_letters;
+        ++(is_foreign ? stats->foreign_letter_rejects : stats->same_side_rejects);
+      }
+    }
+  }
+#endif
+
   //
   // Word
   //
@@ -22,10 +50,38 @@ namespace bng::word_db {
       ++p;
     }
     BNG_VERIFY(letter_count <= 26, "accounting error. can't have %d unique letters", uint32_t(letter_count));
-    is_dead = ((char_count > 0x3f) || length < 3 || letter_count > 12 || has_double);
+    is_dead = ((char_count > 0x3f) || length < 3 || letter_count > kMaxLetterCount || has_double);
     return uint32_t(p - b);
   }
 
+  Word::Word(const ScannedWord& sw) {
+    begin = sw.begin;
+    length = sw.length;
+    letters = sw.letters;
+    letter_count = sw.letter_count();
+    is_dead = ((sw.length > 0x3f) || length < 3 || letter_count > kMaxLetterCount || sw.has_double);
+  }
+
+  uint64_t Word::pair_sig(const char* str) const {
+    if (letter_count > kMaxPairSigLetters) {
+      return 0;
+    }
+    // ranks of the word's letters looked up per character instead of counted.
+    uint8_t rank_of[26] = {};
+    uint32_t rank = 0;
+    for (uint32_t l = uint32_t(letters); l; l &= (l - 1), ++rank) {
+      rank_of[std::countr_zero(l)] = uint8_t(rank);
+    }
+    uint64_t sig = 0;
+    uint32_t prev_rank = rank_of[letter_to_idx(str[0])];
+    for (uint32_t i = 1; i < uint32_t(length); ++i) {
+      const uint32_t cur_rank = rank_of[letter_to_idx(str[i])];
+      sig |= rank_pair_bit(prev_rank, cur_rank);
+      prev_rank = cur_rank;
+    }
+    return sig;
+  }
+
   void Word::letters_to_str(uint64_t letter_bits, char* pout) {
     for (uint32_t li = 0; letter_bits && li < 26; ++li) {
       const auto lb = (1ull << li);
@@ -42,7 +98,7 @@ namespace bng::word_db {
   // TextBuf
   // 
 
-  TextBuf::TextBuf(uint32_t sz) {
+  TextBuf::TextBuf(uint64_t sz) {
     if (sz) {
       _text = new char[sz + 2];
       _capacity = sz;
@@ -50,29 +106,75 @@ namespace bng::word_db {
     }
   }
 
-  Word TextBuf::append(const TextBuf& src, const Word& w) {
-    BNG_VERIFY(_size + w.length <= _capacity, "");
-    auto new_word = Word(w, _size);
-    memcpy(_text + _size, src.ptr(w), w.length);
-    _size += uint32_t(w.length);
-    return new_word;
-  }
-
   //
   // SolutionSet
   //
 
+  void SolutionBlocks::add_block() {
+    if (block_count == block_capacity) {
+      // only the table of block pointers grows. the blocks themselves stay put.
+      block_capacity = block_capacity ? block_capacity * 2 : 16;
+      auto new_blocks = new Solution*[block_capacity];
+      if (block_count) {
+        memcpy(new_blocks, blocks, block_count * sizeof(Solution*));
+      }
+      delete[] blocks;
+      blocks = new_blocks;
+    }
+    blocks[block_count++] = new Solution[kBlockSize];
+    tail_size = 0;
+  }
+
+  void SolutionBlocks::copy_to(Solution* out) const {
+    for (uint32_t bi = 0; bi < block_count; ++bi) {
+      const uint32_t count = (bi + 1 < block_count) ? kBlockSize : tail_size;
+      memcpy(out, blocks[bi], count * sizeof(Solution));
+      out += count;
+    }
+  }
+
   void SolutionSet::sort(const WordDB& wordDB) {
-    std::sort(
-      begin(),
-      end(),
-      [&wordDB](auto& lhs, auto& rhs) -> bool {
-        return
-          (wordDB.word(lhs.a)->length + wordDB.word(lhs.b)->length)
-          <
-          (wordDB.word(rhs.a)->length + wordDB.word(rhs.b)->length);
+    auto _trace = BNG_TRACE_SCOPE("sort");
+    auto _timer = BNG_TIMED_SCOPE("sort");
+    if (_size < 2) {
+      return;
+    }
+
+    // word lengths are 6 bits, so the total length of a solution is below 128.
+    // the keys are found once, then a counting sort places every solution in one pass.
+    constexpr uint32_t kKeyCount = 128;
+    auto keys = std::make_unique<uint8_t[]>(_size);
+    uint32_t key_begin[kKeyCount + 1] = {};
+    for (uint32_t si = 0; si < _size; ++si) {
+      keys[si] = uint8_t(wordDB.word(buf[si].a)->length + wordDB.word(buf[si].b)->length);
+      ++key_begin[keys[si] + 1];
+    }
+    for (uint32_t ki = 1; ki <= kKeyCount; ++ki) {
+      key_begin[ki] += key_begin[ki - 1];
+    }
+
+    auto sorted = new Solution[_capacity];
+    uint32_t key_next[kKeyCount];
+    memcpy(key_next, key_begin, sizeof(key_next));
+    for (uint32_t si = 0; si < _size; ++si) {
+      sorted[key_next[keys[si]]++] = buf[si];
+    }
+
+    // ties in word order, so the result doesn't depend on the order solutions were found in.
+    // solvers mostly find them in word order already.
+    auto by_words = [](const Solution& lhs, const Solution& rhs) {
+      return lhs.a != rhs.a ? lhs.a < rhs.a : lhs.b < rhs.b;
+    };
+    for (uint32_t ki = 0; ki < kKeyCount; ++ki) {
+      auto first = sorted + key_begin[ki];
+      auto last = sorted + key_begin[ki + 1];
+      if (!std::is_sorted(first, last, by_words)) {
+        std::sort(first, last, by_words);
       }
-    );
+    }
+
+    delete[] buf;
+    buf = sorted;
   }
 
 
@@ -80,17 +182,36 @@ namespace bng::word_db {
   // WordDB Public
   //
 
-  WordDB::WordDB(const std::filesystem::path& path) {
+  WordDB::WordDB(const std::filesystem::path& path, uint32_t thread_count) {
+    clear_words_by_letter();
+    load(path, thread_count);
+  }
+
+  WordDB::WordDB(std::span<const std::filesystem::path> paths, uint32_t thread_count) {
     clear_words_by_letter();
-    load(path);
+    load(paths, thread_count);
+  }
+
+  WordDB WordDB::view(const uint8_t* image, uint64_t size, bool verify_checksum) {
+    WordDB db;
+    db.clear_words_by_letter();
+    db.attach_preproc(image, size, "pre image", verify_checksum);
+    return db;
   }
 
   WordDB::~WordDB() {
-    delete words_buf;
     words_buf = nullptr;
+    pair_sigs_buf = nullptr;
+    letter_masks_buf = nullptr;
+    last_letters_buf = nullptr;
+    segment_bases = nullptr;
+    delete class_index;
+    class_index = nullptr;
   }
 
-  bool WordDB::load(const std::filesystem::path& path) {
+  bool WordDB::load(const std::filesystem::path& path, uint32_t thread_count) {
+    auto _trace = BNG_TRACE_SCOPE("load");
+    auto _timer = BNG_TIMED_SCOPE("load");
     BNG_VERIFY(!path.empty(), "invalid path");
     BNG_VERIFY(!*this, "already loaded.");
 
@@ -98,7 +219,7 @@ namespace bng::word_db {
       load_preproc(path);
     }
     else if (path.extension() == ".txt") {
-      load_word_list(path);
+      load_word_lists({ &path, 1 }, thread_count);
     }
     else {
       auto pstr = path.generic_string();
@@ -107,6 +228,20 @@ namespace bng::word_db {
     return *this;
   }
 
+  bool WordDB::load(std::span<const std::filesystem::path> paths, uint32_t thread_count) {
+    auto _trace = BNG_TRACE_SCOPE("load");
+    auto _timer = BNG_TIMED_SCOPE("load");
+    BNG_VERIFY(!paths.empty(), "no paths");
+    BNG_VERIFY(!*this, "already loaded.");
+
+    for (const auto& path : paths) {
+      auto pstr = path.generic_string();
+      BNG_VERIFY(path.extension() == ".txt", "%s has unknown extension. must be .txt", pstr.c_str());
+    }
+    load_word_lists(paths, thread_count);
+    return *this;
+  }
+
   void WordDB::save(const std::filesystem::path& path) {
     BNG_VERIFY(!path.empty(), "invalid path");
     if (path.extension() == ".pre") {
@@ -116,99 +251,329 @@ namespace bng::word_db {
     BNG_VERIFY(false, "path %s has invalid extension, must be .pre", pstr.c_str());
   }
 
-  void WordDB::cull(const SideSet& sides) {
-    uint32_t all_letters = 0;
-    for (auto s : sides) {
-      all_letters |= s.letters;
+  template<uint32_t SIDE_COUNT, uint32_t SIDE_WIDTH>
+  void WordDB::cull(const BasicSideSet<SIDE_COUNT, SIDE_WIDTH>& sides, uint32_t thread_count, SolveStats* stats) {
+    auto _trace = BNG_TRACE_SCOPE("cull");
+    auto _timer = BNG_TIMED_SCOPE("cull");
+    if (is_view) {
+      *this = culled(sides, stats);
+      return;
     }
 
+    const auto side_map = SideMap<BasicSideSet<SIDE_COUNT, SIDE_WIDTH>>(sides);
+    const uint32_t all_letters = side_map.all_letters;
+
     for (uint32_t li = 0; li < 26; ++li) {
       const auto lb = uint32_t(1u << li);
 
       // letter not in puzzle
       if (!(lb & all_letters)) {
+        BNG_SOLVE_STAT(if (stats) { stats->foreign_letter_rejects += live_stats.word_counts[li]; });
         words_by_letter[li] = WordIdx::kInvalid;
         live_stats.word_counts[li] = 0;
         live_stats.size_bytes[li] = 0;
-        continue;
       }
+    }
 
-      // no words start with this letter.
-      if (words_by_letter[li] == WordIdx::kInvalid) {
-        continue;
-      }
+    thread_count = resolve_thread_count(thread_count);
 
-      for (auto wp = first_word_rw(li); *wp; ++wp) {
-        // check for use of unavailable letters
-        if ((wp->letters | all_letters) != all_letters) {
-          cull_word(*wp);
+    if (thread_count == 1) {
+      for (uint32_t li = 0; li < 26; ++li) {
+        // no words start with this letter or letter not in puzzle.
+        if (words_by_letter[li] == WordIdx::kInvalid) {
           continue;
         }
-        for (auto sp = str(*wp), se = str(*wp) + wp->length - 1; sp < se; ++sp) {
-          auto letter_pair = Word::letter_to_bit(sp[0]) | Word::letter_to_bit(sp[1]);
-          BNG_VERIFY(bool(letter_pair & (letter_pair - 1)), "");
-          for (auto s : sides) {
-            auto overlap = s.letters & letter_pair;
-            // hits same side with 2 sequential letters.
-            if (bool(overlap & (overlap - 1))) {
-              cull_word(*wp);
-              goto continue_outer;
+        for (auto wp = first_word_rw(li); *wp; ++wp) {
+          if (wp->is_dead) {
+            continue;
+          }
+          const bool is_kept = is_playable(*wp, side_map);
+          BNG_SOLVE_STAT(count_cull(stats, *wp, all_letters, is_kept));
+          if (!is_kept) {
+            cull_word(*wp);
+          }
+        }
+      }
+    }
+    else {
+      // workers only flag words dead. stats are tallied per chunk and applied
+      // per row afterwards so no two threads touch the same live_stats entry.
+      struct CullTally {
+        uint32_t count = 0;
+        uint32_t size_bytes = 0;
+#if defined(BNG_SOLVE_STATS)
+        SolveStats stats;
+#endif
+      };
+      const uint32_t chunk_size = 1024;
+      auto chunks = std::make_unique<RowChunk[]>(max_row_chunks(words_count(), chunk_size));
+      const auto chunk_count = collect_row_chunks(all_letters, chunk_size, chunks.get());
+      auto tallies = std::make_unique<CullTally[]>(chunk_count);
+
+      parallel_for_chunks(chunk_count, thread_count,
+        [&](uint32_t, uint32_t ci) {
+          const auto& chunk = chunks[ci];
+          auto& tally = tallies[ci];
+          Word* wp = first_word_rw(chunk.letter_i);
+          for (auto wi = chunk.begin; wi < chunk.end; ++wi) {
+            auto& w = wp[wi];
+            if (w.is_dead) {
+              continue;
+            }
+            const bool is_kept = is_playable(w, side_map);
+            BNG_SOLVE_STAT(count_cull(&tally.stats, w, all_letters, is_kept));
+            if (!is_kept) {
+              w.is_dead = true;
+              ++tally.count;
+              tally.size_bytes += uint32_t(w.length);
             }
           }
+        });
+
+      for (uint32_t ci = 0; ci < chunk_count; ++ci) {
+        const auto li = chunks[ci].letter_i;
+        BNG_VERIFY(live_stats.word_counts[li] >= tallies[ci].count, "");
+        BNG_VERIFY(live_stats.size_bytes[li] >= tallies[ci].size_bytes, "");
+        live_stats.word_counts[li] -= tallies[ci].count;
+        live_stats.size_bytes[li] -= tallies[ci].size_bytes;
+        BNG_SOLVE_STAT(if (stats) { *stats += tallies[ci].stats; });
+      }
+    }
+
+    *this = clone_packed(thread_count);
+  }
+
+  template<uint32_t SIDE_COUNT, uint32_t SIDE_WIDTH>
+  WordDB WordDB::culled(const BasicSideSet<SIDE_COUNT, SIDE_WIDTH>& sides, SolveStats* stats) const {
+    auto _trace = BNG_TRACE_SCOPE("culled");
+    auto _timer = BNG_TIMED_SCOPE("culled");
+    const auto side_map = SideMap<BasicSideSet<SIDE_COUNT, SIDE_WIDTH>>(sides);
+    const uint32_t all_letters = side_map.all_letters;
+
+    // same filtering as cull(), but the verdicts go to a side table so this db is untouched.
+    auto keep = std::make_unique<uint8_t[]>(words_count());
+    TextStats keep_stats;
+
+    for (uint32_t li = 0; li < 26; ++li) {
+      // letter not in puzzle or no words start with this letter.
+      if (!(all_letters & (1u << li)) || words_by_letter[li] == WordIdx::kInvalid) {
+        BNG_SOLVE_STAT(if (stats) { stats->foreign_letter_rejects += live_stats.word_counts[li]; });
+        continue;
+      }
+      // most words have a letter outside the puzzle, found from the mask column alone.
+      // only the rest read their Word.
+      const uint32_t row_begin = uint32_t(words_by_letter[li]);
+      const uint32_t* masks = letter_masks_buf + row_begin;
+      for (uint32_t ri = 0, row_end = row_size(li); ri < row_end; ++ri) {
+        const bool is_foreign = (masks[ri] | all_letters) != all_letters;
+        const Word& w = words_buf[row_begin + ri];
+        const bool is_kept = !is_foreign && !w.is_dead && is_playable(w, side_map);
+        BNG_SOLVE_STAT(if (!w.is_dead) { count_cull(stats, w, all_letters, is_kept); });
+        keep[row_begin + ri] = uint8_t(is_kept);
+        keep_stats.word_counts[li] += uint32_t(is_kept);
+        keep_stats.size_bytes[li] += is_kept ? uint32_t(w.length) : 0;
+      }
+    }
+
+    return clone_packed(keep_stats, keep.get());
+  }
+
+  template<uint32_t SIDE_COUNT, uint32_t SIDE_WIDTH>
+  SolutionSet WordDB::solve(const BasicSideSet<SIDE_COUNT, SIDE_WIDTH>& sides, uint32_t thread_count, SolveStats* stats) const {
+    auto _trace = BNG_TRACE_SCOPE("solve");
+    auto _timer = BNG_TIMED_SCOPE("solve");
+    // pairing words only compares letter masks, so past here every geometry is the same.
+    return solve_letters(puzzle_letters(sides), thread_count, stats);
+  }
+
+  SolutionSet WordDB::solve_letters(uint32_t all_letters, uint32_t thread_count, SolveStats* stats) const {
+    if (!all_letters) {
+      return SolutionSet();
+    }
+
+    if (class_index) {
+      return class_index->solve(all_letters);
+    }
+
+    // candidateB letter masks, contiguous and padded for the match kernel.
+    const auto mask_rows = LetterMaskRows(*this);
+    const auto hits_size = mask_rows.max_padded_count() + LetterMaskRows::kPadCount;
+
+    thread_count = resolve_thread_count(thread_count);
+
+    // solutions go to blocks as they are found, then to one exactly sized set.
+    if (thread_count == 1) {
+      SolutionBlocks blocks;
+      auto hits = std::make_unique<uint32_t[]>(hits_size);
+
+      // run through all letters used in the puzzle
+      for (uint32_t ali = 0; ali < 26; ++ali) {
+        const auto alb = uint32_t(1u << ali);
+        if (!(alb & all_letters) || !first_word(ali)) {
+          continue;
         }
-      continue_outer:
-        ;
+        // run through all words starting with this letter - these are candidateA
+        const auto wia = uint32_t(words_by_letter[ali]);
+        solve_range(wia, wia + row_size(ali), all_letters, mask_rows, hits.get(), blocks, stats);
       }
+
+      BNG_VERIFY(blocks.size() <= ~0u, "too many solutions");
+      SolutionSet solutions{ uint32_t(blocks.size()) };
+      solutions.set_size(uint32_t(blocks.size()));
+      blocks.copy_to(solutions.begin());
+      return solutions;
     }
 
-    *this = clone_packed();
+    // many small chunks of candidateA, claimed by workers as they go.
+    // each worker collects into its own blocks.
+    const uint32_t chunk_size = 64;
+    auto chunks = std::make_unique<RowChunk[]>(max_row_chunks(words_count(), chunk_size));
+    const auto chunk_count = collect_row_chunks(all_letters, chunk_size, chunks.get());
+    thread_count = std::min(thread_count, std::max(chunk_count, 1u));
+
+    auto worker_solutions = std::make_unique<SolutionBlocks[]>(thread_count);
+    auto worker_hits = std::make_unique<std::unique_ptr<uint32_t[]>[]>(thread_count);
+    for (uint32_t wi = 0; wi < thread_count; ++wi) {
+      worker_hits[wi] = std::make_unique<uint32_t[]>(hits_size);
+    }
+    // worker stats are only allocated when stats were asked for.
+    std::unique_ptr<SolveStats[]> worker_stats;
+    BNG_SOLVE_STAT(if (stats) { worker_stats = std::make_unique<SolveStats[]>(thread_count); });
+
+    parallel_for_chunks(chunk_count, thread_count,
+      [&](uint32_t wi, uint32_t ci) {
+        const auto& chunk = chunks[ci];
+        const auto wia = uint32_t(words_by_letter[chunk.letter_i]);
+        solve_range(wia + chunk.begin, wia + chunk.end, all_letters, mask_rows,
+          worker_hits[wi].get(), worker_solutions[wi], worker_stats ? &worker_stats[wi] : nullptr);
+      });
+    BNG_SOLVE_STAT(for (uint32_t wi = 0; worker_stats && wi < thread_count; ++wi) { *stats += worker_stats[wi]; });
+
+    // merge. each worker copies into its own slice of the output.
+    auto offsets = std::make_unique<uint64_t[]>(thread_count);
+    uint64_t total = 0;
+    for (uint32_t wi = 0; wi < thread_count; ++wi) {
+      offsets[wi] = total;
+      total += worker_solutions[wi].size();
+    }
+
+    BNG_VERIFY(total <= ~0u, "too many solutions");
+    SolutionSet solutions{ uint32_t(total) };
+    solutions.set_size(uint32_t(total));
+    parallel_for_chunks(thread_count, thread_count,
+      [&](uint32_t, uint32_t wi) {
+        worker_solutions[wi].copy_to(solutions.begin() + offsets[wi]);
+      });
+
+    return solutions;
+  }
+
+  void WordDB::solve_range(
+    uint32_t wia, uint32_t wia_end, uint32_t all_letters,
+    const LetterMaskRows& mask_rows, uint32_t* hits, SolutionBlocks& solutions, SolveStats* stats) const 
+  {
+    (void)stats;
+    BNG_VERIFY(wia <= wia_end && wia_end <= words_count(), "");
+    const auto match = kernel::match_fn();
+
+    // candidateA only needs its letters and last letter, streamed from their columns.
+    for (; wia < wia_end; ++wia) {
+      // test all words starting with the last letter of candidateA - these are candidateB
+      const uint32_t bli = last_letters_buf[wia];
+      const auto b_count = mask_rows.row_count(bli);
+      if (!b_count) {
+        continue;
+      }
+      const auto hit_count = match(
+        mask_rows.row(bli), LetterMaskRows::padded_count(b_count),
+        letter_masks_buf[wia], all_letters, hits);
+      BNG_SOLVE_STAT(if (stats) {
+        ++stats->candidates_a;
+        stats->pairs_compared += b_count;
+        stats->row_hits[bli] += hit_count;
+      });
+      const auto wib_first = uint32_t(words_by_letter[bli]);
+      for (uint32_t hi = 0; hi < hit_count; ++hi) {
+        solutions.add(WordIdx(wia), WordIdx(wib_first + hits[hi]));
+      }
+    }
+  }
+
+  uint64_t WordDB::count_solutions(const SideSet& sides) const {
+    const uint32_t all_letters = puzzle_letters(sides);
+    if (!all_letters) {
+      return 0;
+    }
+    return class_index ? class_index->count(all_letters) : ComplementIndex(*this, all_letters).count();
+  }
+
+  SolutionSet WordDB::solve_complement(const SideSet& sides) const {
+    auto _trace = BNG_TRACE_SCOPE("solve_complement");
+    auto _timer = BNG_TIMED_SCOPE("solve_complement");
+    const uint32_t all_letters = puzzle_letters(sides);
+    if (!all_letters) {
+      return SolutionSet();
+    }
+    return ComplementIndex(*this, all_letters).solve();
+  }
+
+  void WordDB::build_class_index() {
+    delete class_index;
+    class_index = new WordClassIndex(*this);
   }
 
-  SolutionSet WordDB::solve(const SideSet& sides) const {
+  template<uint32_t SIDE_COUNT, uint32_t SIDE_WIDTH>
+  uint32_t WordDB::puzzle_letters(const BasicSideSet<SIDE_COUNT, SIDE_WIDTH>& sides) {
+    using Sides = BasicSideSet<SIDE_COUNT, SIDE_WIDTH>;
     uint32_t all_letters = 0;
     char letters_str[27] = {};
 
     for (const auto& s : sides) {
-      if (s.letter_count != 3) {
+      if (s.letter_count != Sides::kSideWidth) {
         auto si = uint32_t(intptr_t(&s - &sides.front()));
         s.get_letters_str(letters_str);
-        BNG_PRINT("side[%d] %s is not 3 letters.\n",
-          si + 1, letters_str);
-        return SolutionSet();
+        BNG_PRINT("side[%d] %s is not %d letters.\n",
+          si + 1, letters_str, Sides::kSideWidth);
+        return 0;
       }
       all_letters |= uint32_t(s.letters);
     }
     const auto all_letter_count = count_bits(all_letters);
-    if (all_letter_count != 12) {
+    if (all_letter_count != Sides::kLetterCount) {
       Word::letters_to_str(all_letters, letters_str);
-      BNG_PRINT("puzzle must have 12 unique letters, not %d (%s)\n",
-        all_letter_count, letters_str);
-      return SolutionSet();
+      BNG_PRINT("puzzle must have %d unique letters, not %d (%s)\n",
+        Sides::kLetterCount, all_letter_count, letters_str);
+      return 0;
     }
 
-    SolutionSet solutions(size() / 2);
+    return all_letters;
+  }
 
-    // run through all letters used in the puzzle
-    for (uint32_t ali = 0; ali < 26; ++ali) {
-      const auto alb = uint32_t(1u << ali);
-      if (!(alb & all_letters)) {
-        continue;
+  WordIdx WordDB::find_word(const char* text, uint32_t length) const {
+    const auto lbit = length ? Word::letter_to_bit(text[0]) : 0;
+    if (!lbit) {
+      return WordIdx::kInvalid;
+    }
+    // rows keep the order of the sorted word list. see compare.
+    const uint32_t li = uint32_t(std::countr_zero(lbit));
+    const auto key = WordRef{ text, length };
+    uint32_t lo = uint32_t(words_by_letter[li] != WordIdx::kInvalid ? words_by_letter[li] : WordIdx(0));
+    uint32_t hi = lo + row_size(li);
+    while (lo < hi) {
+      const uint32_t mid = lo + (hi - lo) / 2;
+      const auto& w = words_buf[mid];
+      const int cmp = compare(WordRef{ str(w), uint32_t(w.length) }, key);
+      if (!cmp) {
+        return WordIdx(mid);
       }
-
-      // run through all words starting with this letter - these are candidateA
-      for (auto wpa = first_word(ali); wpa && *wpa; ++wpa) {
-        // run through all words starting with the last letter of candidateA - these are candidateB
-        const auto bli = last_letter_idx(*wpa);
-        for (auto wpb = first_word(bli); wpb && *wpb; ++wpb) {
-          const auto hit_letters = wpa->letters | wpb->letters;
-          if (hit_letters == all_letters) {
-            solutions.add(word_i(*wpa), word_i(*wpb));
-          }
-        }
+      if (cmp < 0) {
+        lo = mid + 1;
+      }
+      else {
+        hi = mid;
       }
     }
-
-    return solutions;
+    return WordIdx::kInvalid;
   }
 
   bool WordDB::is_equivalent(const WordDB& rhs) const {
@@ -217,6 +582,10 @@ namespace bng::word_db {
       !memcmp(&live_stats, &rhs.live_stats, sizeof(live_stats)) &&
       !memcmp(words_by_letter, rhs.words_by_letter, sizeof(words_by_letter)) &&
       !memcmp(words_buf, rhs.words_buf, words_size_bytes()) &&
+      !memcmp(pair_sigs_buf, rhs.pair_sigs_buf, pair_sigs_size_bytes()) &&
+      !memcmp(letter_masks_buf, rhs.letter_masks_buf, letter_masks_size_bytes()) &&
+      !memcmp(last_letters_buf, rhs.last_letters_buf, last_letters_size_bytes()) &&
+      !memcmp(segment_bases, rhs.segment_bases, segment_bases_size_bytes()) &&
       !memcmp(text_buf.begin(), rhs.text_buf.begin(), text_buf.size());
   }
 
@@ -224,156 +593,338 @@ namespace bng::word_db {
   // WordDB Private
   //
 
-  void WordDB::load_preproc(const std::filesystem::path& path) {
-    BNG_VERIFY(!path.empty() && path.extension() == ".pre", "invalid path");
+  namespace {
+    // .pre file layout: PreHeader, then the words, pair signature, letter mask, last letter,
+    // segment base and text sections,
+    // each starting on a page boundary so a mapped file can be used in place.
+    struct PreHeader {
+      static constexpr uint64_t kMagic = 0x4552505f42445742ull; // "BWDB_PRE"
+      static constexpr uint32_t kVersion = 4;
+      static constexpr uint64_t kSectionAlign = 4096;
 
-    auto pathStr = path.generic_string();
-    if (auto fin = File(pathStr.c_str(), "rb")) {
-      if (fread(this, header_size_bytes(), 1, fin) != 1) {
-        *this = WordDB();
-        return;
-      }
-      live_stats = mem_stats;
+      struct Section {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+      };
+
+      uint64_t magic = kMagic;
+      uint32_t version = kVersion;
+      uint32_t header_size = sizeof(PreHeader);
+      uint64_t fingerprint = 0;
+      // hash_bytes over the sections in order
+      uint64_t checksum = 0;
+      TextStats mem_stats;
+      WordIdx words_by_letter[26] = {};
+      Section words;
+      Section pair_sigs;
+      Section letter_masks;
+      Section last_letters;
+      Section segment_bases;
+      // text is followed by 2 null bytes not counted in size.
+      Section text;
 
-      words_buf = new Word[words_count()];
-      if (fread(words_buf, words_size_bytes(), 1, fin) != 1) {
-        BNG_VERIFY(false, "failed reading words buffer from %s", pathStr.c_str());
+      static uint64_t align(uint64_t offset) {
+        return (offset + kSectionAlign - 1) & ~(kSectionAlign - 1);
       }
 
-      text_buf = TextBuf(mem_stats.total_size_bytes());
-      text_buf.set_size(text_buf.capacity());
-      if (fread(text_buf.begin(), text_buf.capacity(), 1, fin) != 1) {
-        BNG_VERIFY(false, "failed reading text buffer from %s", pathStr.c_str());
+      bool is_section_valid(const Section& section, uint64_t file_size) const {
+        return
+          !(section.offset & (kSectionAlign - 1)) &&
+          section.offset >= sizeof(PreHeader) &&
+          section.offset <= file_size &&
+          section.size <= file_size - section.offset;
       }
+    };
+    static_assert(std::is_trivially_copyable_v<PreHeader>);
+
+    uint64_t pre_checksum(const uint8_t* base, const PreHeader& header) {
+      uint64_t h = hash_bytes(base + header.words.offset, header.words.size);
+      h = hash_bytes(base + header.pair_sigs.offset, header.pair_sigs.size, h);
+      h = hash_bytes(base + header.letter_masks.offset, header.letter_masks.size, h);
+      h = hash_bytes(base + header.last_letters.offset, header.last_letters.size, h);
+      h = hash_bytes(base + header.segment_bases.offset, header.segment_bases.size, h);
+      return hash_bytes(base + header.text.offset, header.text.size + 2, h);
+    }
+  } // namespace
+
+  void WordDB::load_preproc(const std::filesystem::path& path) {
+    BNG_VERIFY(!path.empty() && path.extension() == ".pre", "invalid path");
+
+    const auto pathStr = path.generic_string();
+    auto mapped = core::MappedFile(pathStr.c_str());
+    if (mapped && attach_preproc(mapped.data(), mapped.size(), pathStr.c_str())) {
+      mapping = std::move(mapped);
     }
   }
 
+  bool WordDB::attach_preproc(const uint8_t* image, uint64_t size, const char* name, bool verify_checksum) {
+    // any mismatch leaves the db empty, so the caller treats the file as missing and rebuilds it.
+    if (!image || size < sizeof(PreHeader) || (uintptr_t(image) & (alignof(Word) - 1))) {
+      return false;
+    }
+
+    PreHeader header;
+    memcpy((void*)&header, image, sizeof(header));
+    if (header.magic != PreHeader::kMagic ||
+      header.version != PreHeader::kVersion ||
+      header.header_size != sizeof(PreHeader)) {
+      return false;
+    }
+
+    const uint64_t word_count = header.mem_stats.total_count(/*null_terminated*/true);
+    const uint64_t segment_count = (word_count + kSegmentWords - 1) >> kSegmentShift;
+    if (!header.is_section_valid(header.words, size) ||
+      !header.is_section_valid(header.pair_sigs, size) ||
+      !header.is_section_valid(header.letter_masks, size) ||
+      !header.is_section_valid(header.last_letters, size) ||
+      !header.is_section_valid(header.segment_bases, size) ||
+      !header.is_section_valid(header.text, size - 2) ||
+      header.words.size != word_count * sizeof(Word) ||
+      header.pair_sigs.size != word_count * sizeof(uint64_t) ||
+      header.letter_masks.size != word_count * sizeof(uint32_t) ||
+      header.last_letters.size != word_count * sizeof(uint8_t) ||
+      header.segment_bases.size != segment_count * sizeof(uint64_t) ||
+      header.text.size != header.mem_stats.total_size_bytes()) {
+      BNG_PRINT("%s has invalid sections. ignoring it.\n", name);
+      return false;
+    }
+
+    if (verify_checksum && pre_checksum(image, header) != header.checksum) {
+      BNG_PRINT("%s failed its checksum. ignoring it.\n", name);
+      return false;
+    }
+
+    mem_stats = live_stats = header.mem_stats;
+    memcpy(words_by_letter, header.words_by_letter, sizeof(words_by_letter));
+    fingerprint = header.fingerprint;
+    words_buf = reinterpret_cast<Word*>(const_cast<uint8_t*>(image + header.words.offset));
+    pair_sigs_buf = reinterpret_cast<uint64_t*>(const_cast<uint8_t*>(image + header.pair_sigs.offset));
+    letter_masks_buf = reinterpret_cast<uint32_t*>(const_cast<uint8_t*>(image + header.letter_masks.offset));
+    last_letters_buf = const_cast<uint8_t*>(image + header.last_letters.offset);
+    segment_bases = reinterpret_cast<uint64_t*>(const_cast<uint8_t*>(image + header.segment_bases.offset));
+    text_buf = TextBuf::view(
+      reinterpret_cast<const char*>(image + header.text.offset), header.text.size);
+    is_view = true;
+    return true;
+  }
+
   void WordDB::save_preproc(const std::filesystem::path& path) const {
-    BNG_VERIFY(!path.empty() && path.extension() == ".stp", "");
+    BNG_VERIFY(!path.empty() && path.extension() == ".pre", "");
     BNG_VERIFY(text_buf.size() == live_stats.total_size_bytes(), "");
+
+    PreHeader header;
+    header.fingerprint = fingerprint;
+    header.mem_stats = mem_stats;
+    memcpy(header.words_by_letter, words_by_letter, sizeof(words_by_letter));
+    header.words = { PreHeader::align(sizeof(PreHeader)), words_size_bytes() };
+    header.pair_sigs = { PreHeader::align(header.words.offset + header.words.size), pair_sigs_size_bytes() };
+    header.letter_masks = { PreHeader::align(header.pair_sigs.offset + header.pair_sigs.size), letter_masks_size_bytes() };
+    header.last_letters = {
+      PreHeader::align(header.letter_masks.offset + header.letter_masks.size), last_letters_size_bytes() };
+    header.segment_bases = {
+      PreHeader::align(header.last_letters.offset + header.last_letters.size), segment_bases_size_bytes() };
+    header.text = { PreHeader::align(header.segment_bases.offset + header.segment_bases.size), text_buf.size() };
+
+    // the checksum runs over the sections as laid out in the file.
+    const uint64_t file_size = header.text.offset + header.text.size + 2;
+    auto image = std::make_unique<uint8_t[]>(file_size);
+    memcpy(image.get() + header.words.offset, words_buf, header.words.size);
+    memcpy(image.get() + header.pair_sigs.offset, pair_sigs_buf, header.pair_sigs.size);
+    memcpy(image.get() + header.letter_masks.offset, letter_masks_buf, header.letter_masks.size);
+    memcpy(image.get() + header.last_letters.offset, last_letters_buf, header.last_letters.size);
+    memcpy(image.get() + header.segment_bases.offset, segment_bases, header.segment_bases.size);
+    memcpy(image.get() + header.text.offset, text_buf.begin(), header.text.size);
+    header.checksum = pre_checksum(image.get(), header);
+    memcpy(image.get(), (const void*)&header, sizeof(header));
+
     auto fout = File(path.generic_string().c_str(), "wb");
     BNG_VERIFY(fout, "");
-    if (fwrite(this, header_size_bytes(), 1, fout) != 1) {
-      BNG_VERIFY(false, "");
-    }
-    if (fwrite(words_buf, words_size_bytes(), 1, fout) != 1) {
-      BNG_VERIFY(false, "");
-    }
-    if (fwrite(text_buf.begin(), text_buf.size(), 1, fout) != 1) {
+    if (fwrite(image.get(), file_size, 1, fout) != 1) {
       BNG_VERIFY(false, "");
     }
   }
 
 
-  void WordDB::load_word_list(const std::filesystem::path& path) {
-    BNG_VERIFY(!path.empty() && path.extension() == ".txt", "");
-    text_buf = TextBuf();
+  void WordDB::process_word_list(uint32_t thread_count) {
+    BNG_VERIFY(text_buf, "");
+    thread_count = resolve_thread_count(thread_count);
 
-    const auto pathStr = path.generic_string();
-    if (auto dict_file = File(pathStr.c_str(), "r")) {
-      text_buf = TextBuf(dict_file.size_bytes());
-      if (size_t read_count = fread(text_buf.begin(), 1, text_buf.capacity(), dict_file.fp)) {
-        if (read_count < text_buf.capacity()) {
-          memset(text_buf.begin() + read_count, 0, text_buf.capacity() - read_count);
-          text_buf.set_size(uint32_t(read_count));
-        }
-      }
-      else {
-        BNG_VERIFY(false, "failed reading %s", pathStr.c_str());
-        return;
-      }
+    // stats and words each run on independent pieces of the text, stitched
+    // together with prefix sums over the per letter counts.
+    const uint32_t chunk_size = 64 * 1024;
+    auto chunks = std::make_unique<TextChunk[]>(text_buf.size() / chunk_size + 1);
+    const auto chunk_count = collect_text_chunks(text_buf, chunk_size, chunks.get());
 
-      process_word_list();
+    parallel_for_chunks(chunk_count, thread_count,
+      [&](uint32_t, uint32_t ci) {
+        collect_live_stats(chunks[ci]);
+      });
+
+    if (!is_sorted(chunks.get(), chunk_count)) {
+      text_buf = sort_word_list(text_buf, thread_count);
+      process_word_list(thread_count);
+      return;
     }
-  }
 
-  void WordDB::process_word_list() {
-    mem_stats = text_buf.collect_stats();
+    mem_stats = TextStats{};
+    for (uint32_t ci = 0; ci < chunk_count; ++ci) {
+      for (uint32_t li = 0; li < 26; ++li) {
+        // lists are sorted before they get here. a chunk can only add to the last row so far or later ones.
+        BNG_VERIFY(!chunks[ci].stats.word_counts[li] || li == 25 || !mem_stats.word_counts[li + 1], "");
+        mem_stats.word_counts[li] += chunks[ci].stats.word_counts[li];
+        mem_stats.size_bytes[li] += chunks[ci].stats.size_bytes[li];
+      }
+    }
     BNG_VERIFY(mem_stats, "");
+    live_stats = mem_stats;
 
-    collate_words();
-    *this = clone_packed();
+    collate_words(chunks.get(), chunk_count, thread_count);
   }
 
-  TextStats TextBuf::collect_stats() const {
-    BNG_VERIFY(*this, "");
-    auto stats = TextStats{};
-   
-    for (const char* p = begin(); *p; ) {
-      const auto pw = p;
-      auto li = Word::letter_to_idx(*p);
-      BNG_VERIFY(li < 26, "");
-      ++stats.word_counts[li];
-      // catch out of order dictionary
-      BNG_VERIFY(li == 25 || !stats.word_counts[li + 1], "");
+  uint32_t WordDB::collect_text_chunks(const TextBuf& text, uint32_t chunk_size, TextChunk* chunks) {
+    uint32_t chunk_count = 0;
+    for (const char* p = text.begin(); p < text.end(); ) {
+      auto& chunk = chunks[chunk_count++];
+      chunk.begin = p;
+      // move the split point forward to the start of the next word.
+      p = (uint64_t(text.end() - p) > chunk_size) ? p + chunk_size : text.end();
       while (Word::letter_to_bit(*p)) {
         ++p;
       }
       while (*p && !Word::letter_to_bit(*p)) {
         ++p;
       }
-      stats.size_bytes[li] += uint32_t(p - pw);
+      p = *p ? p : text.end();
+      chunk.end = p;
+    }
+    return chunk_count;
+  }
+
+  void WordDB::collect_live_stats(TextChunk& chunk) {
+    chunk.stats = TextStats{};
+    chunk.is_sorted = true;
+    chunk.first = chunk.last = WordRef{};
+    scan_words(chunk.begin, 0, uint32_t(chunk.end - chunk.begin),
+      [&](const ScannedWord& sw) {
+        const auto w = Word(sw);
+        if (w.is_dead) {
+          return;
+        }
+        const auto li = sw.first_letter;
+        ++chunk.stats.word_counts[li];
+        chunk.stats.size_bytes[li] += w.length;
+
+        const auto ref = WordRef{ chunk.begin + sw.begin, sw.length };
+        if (chunk.first.text) {
+          chunk.is_sorted = chunk.is_sorted && compare(chunk.last, ref) < 0;
+        }
+        else {
+          chunk.first = ref;
+        }
+        chunk.last = ref;
+      });
+  }
+
+  bool WordDB::is_sorted(const TextChunk* chunks, uint32_t chunk_count) {
+    const WordRef* prev = nullptr;
+    for (uint32_t ci = 0; ci < chunk_count; ++ci) {
+      const auto& chunk = chunks[ci];
+      if (!chunk.is_sorted || (prev && chunk.first.text && compare(*prev, chunk.first) >= 0)) {
+        return false;
+      }
+      prev = chunk.first.text ? &chunk.last : prev;
     }
+    return true;
+  }
+
+  TextStats TextBuf::collect_stats() const {
+    return collect_stats(begin(), end());
+  }
+
+  TextStats TextBuf::collect_stats(const char* p, const char* p_end) const {
+    BNG_VERIFY(*this && uint64_t(p_end - p) <= ~0u, "");
+    auto stats = TextStats{};
+
+    scan_words(p, 0, uint32_t(p_end - p),
+      [&](const ScannedWord& sw) {
+        const auto li = sw.first_letter;
+        ++stats.word_counts[li];
+        stats.size_bytes[li] += sw.span;
+      });
 
     return stats;
   }
 
-  void WordDB::collate_words() {
+  void WordDB::collate_words(TextChunk* chunks, uint32_t chunk_count, uint32_t thread_count) {
     BNG_VERIFY(!words_buf, "");
-    words_buf = new Word[words_count()];
-
-    auto wp = words_buf;
-    const Word* wp_row_start = wp;
-    uint32_t row_live_count = 0;
-    uint32_t row_live_size_bytes = 0;
+    // the live words and their text go straight to packed rows. null terminators
+    // are the zeroed Word.
+    auto packed_text = alloc_storage(mem_stats.total_size_bytes());
 
+    // each row holds its words and a null terminator. a chunk's words of a letter
+    // and their text follow those of the chunks before it.
+    // a segment is based at the text of the chunk its first word comes from. that is
+    // at most a chunk ahead of the word, so all of the segment's words are in reach.
     clear_words_by_letter();
-
-    const char* p = text_buf.begin();
-    for (; *p; ++wp) {
-      BNG_VERIFY(text_buf.in_capacity(p), "");
-      auto li = Word::letter_to_idx(*p);
-      if (words_by_letter[li] == WordIdx::kInvalid) {
-        if (li) {
-          // null terminate
-          *wp++ = Word();
-          const auto row_total_count = uint32_t(wp - wp_row_start); (void)row_total_count;
-          BNG_VERIFY(row_total_count == mem_stats.word_counts[li - 1] + 1, "");
-          live_stats.word_counts[li - 1] = row_live_count;
-          live_stats.size_bytes[li - 1] = row_live_size_bytes;
-          row_live_count = 0;
-          row_live_size_bytes = 0;
-          wp_row_start = wp;
+    uint32_t word_begin = 0;
+    uint64_t text_begin = 0;
+    for (uint32_t li = 0; li < 26; ++li) {
+      if (!mem_stats.word_counts[li]) {
+        continue;
+      }
+      words_by_letter[li] = WordIdx(word_begin);
+      for (uint32_t ci = 0; ci < chunk_count; ++ci) {
+        const auto word_end = word_begin + chunks[ci].stats.word_counts[li];
+        for (uint32_t si = (word_begin + kSegmentWords - 1) >> kSegmentShift; (si << kSegmentShift) < word_end; ++si) {
+          segment_bases[si] = text_begin;
         }
-        // cache the start of the word list.
-        words_by_letter[li] = word_i(*wp);
+        chunks[ci].word_begin[li] = word_begin;
+        chunks[ci].text_begin[li] = text_begin;
+        word_begin = word_end;
+        text_begin += chunks[ci].stats.size_bytes[li];
       }
-      p += wp->read_str(text_buf, p);
-      if (!wp->is_dead) {
-        row_live_size_bytes += uint32_t(wp->length);
-        ++row_live_count;
+      // a segment starting on the null terminator starts with the next row's text.
+      if (!(word_begin & (kSegmentWords - 1))) {
+        segment_bases[word_begin >> kSegmentShift] = text_begin;
       }
+      ++word_begin;
     }
+    BNG_VERIFY(word_begin == words_count() && text_begin == packed_text.size(), "");
 
-    BNG_VERIFY(p == text_buf.end(), "");
+    parallel_for_chunks(chunk_count, thread_count,
+      [&](uint32_t, uint32_t ci) {
+        const auto& chunk = chunks[ci];
+        uint32_t next_word[26];
+        uint64_t next_text[26];
+        memcpy(next_word, chunk.word_begin, sizeof(next_word));
+        memcpy(next_text, chunk.text_begin, sizeof(next_text));
+        scan_words(chunk.begin, 0, uint32_t(chunk.end - chunk.begin),
+          [&](const ScannedWord& sw) {
+            const auto w = Word(sw);
+            if (w.is_dead) {
+              return;
+            }
+            const char* text = chunk.begin + sw.begin;
+            const auto li = sw.first_letter;
+            const auto wi = next_word[li]++;
+            const auto offset = next_text[li];
+            next_text[li] += w.length;
+            BNG_VERIFY(offset - segment_bases[wi >> kSegmentShift] <= Word::kMaxBegin, "");
+            words_buf[wi] = Word(w, uint32_t(offset - segment_bases[wi >> kSegmentShift]));
+            pair_sigs_buf[wi] = w.pair_sig(text);
+            letter_masks_buf[wi] = uint32_t(w.letters);
+            last_letters_buf[wi] = uint8_t(Word::letter_to_idx(text[w.length - 1]));
+            memcpy(packed_text.begin() + offset, text, w.length);
+          });
+      });
 
-    {
-      // null terminate
-      *wp++ = Word();
-      const auto row_total_count = uint32_t(wp - wp_row_start); (void)row_total_count;
-      BNG_VERIFY(row_total_count == mem_stats.word_counts[25] + 1, "");
-      live_stats.word_counts[25] = row_live_count;
-      live_stats.size_bytes[25] = row_live_size_bytes;
-    }
+    text_buf = std::move(packed_text);
 
     for (uint32_t i = 0; i < 26; ++i) {
-      if (!live_stats.word_counts[i]) {
-        words_by_letter[i] = WordIdx::kInvalid;
+      if (mem_stats.word_counts[i]) {
+        BNG_VERIFY(!*(first_word(i) + mem_stats.word_counts[i]), "word list for letter not null terminated.");
       }
     }
-
-    BNG_VERIFY(uint32_t(wp - words_buf) == words_count(), "");
-    BNG_VERIFY(first_letter_idx(*(wp - 2)) == 25, "");
   }
 
   void WordDB::cull_word(Word& word) {
@@ -385,53 +936,226 @@ namespace bng::word_db {
     word.is_dead = true;
   }
 
-  WordDB WordDB::clone_packed() const {
-    const uint32_t live_size = live_stats.total_size_bytes();
-    const uint32_t live_count = live_stats.total_count(); (void)live_count;
+  template<typename Sides>
+  WordDB::SideMap<Sides>::SideMap(const Sides& sides) {
+    for (auto s : sides) {
+      all_letters |= uint32_t(s.letters);
+    }
+    for (uint32_t si = 0; si < Sides::kSideCount; ++si) {
+      for (uint32_t li = 0; li < 26; ++li) {
+        if (sides[si].letters & (1u << li)) {
+          side_of[uint8_t(Word::idx_to_letter(li))] = uint8_t(si + 1);
+        }
+      }
+    }
+    if constexpr (kHasPairTable) {
+      build_pair_table(sides);
+    }
+  }
+
+  template<typename Sides>
+  void WordDB::SideMap<Sides>::build_pair_table(const Sides& sides) {
+    // local letters below each local letter that are on the same side.
+    uint32_t lower_same_side[kLocalCount] = {};
+    for (uint32_t li = 0, local_i = 0; li < 26 && local_i < kLocalCount; ++li) {
+      const auto lb = uint32_t(1u << li);
+      if (!(all_letters & lb)) {
+        continue;
+      }
+      for (uint32_t si = 0; si < Sides::kSideCount; ++si) {
+        if (sides[si].letters & lb) {
+          // lower letters already have their local bits.
+          lower_same_side[local_i] = local_mask(uint32_t(sides[si].letters) & (lb - 1));
+        }
+      }
+      for (uint32_t b = 0; b < 256; ++b) {
+        if (b & (1u << (li & 7))) {
+          local_of_byte[li >> 3][b] |= uint16_t(1u << local_i);
+        }
+      }
+      ++local_i;
+    }
+
+    // adding the highest letter of mask to mask without it leaves the lower ranks as they are
+    // and only adds pairs of the new top rank with lower letters on its side.
+    for (uint32_t mask = 1; mask < (1u << kLocalCount); ++mask) {
+      const auto top = uint32_t(31 - std::countl_zero(mask));
+      uint64_t pairs = same_side_rank_pairs[mask ^ (1u << top)];
+      const uint32_t top_rank = count_bits(mask) - 1;
+      // words with all 12 letters have no signature, so there is no rank 11 to encode.
+      const uint32_t same_side = (top_rank < Word::kMaxPairSigLetters) ? mask & lower_same_side[top] : 0;
+      if (same_side) {
+        for (uint32_t m = same_side; m; m &= (m - 1)) {
+          pairs |= Word::rank_pair_bit(count_bits(mask & ((m & (0u - m)) - 1)), top_rank);
+        }
+      }
+      same_side_rank_pairs[mask] = pairs;
+    }
+  }
+
+  template<typename Sides>
+  bool WordDB::is_playable(const Word& word, const SideMap<Sides>& side_map) const {
+    // check for use of unavailable letters
+    if ((word.letters | side_map.all_letters) != side_map.all_letters) {
+      return false;
+    }
+    if constexpr (SideMap<Sides>::kHasPairTable) {
+      if (const uint64_t sig = pair_sig(word)) {
+        return !(sig & side_map.same_side_pairs(uint32_t(word.letters)));
+      }
+    }
+    // too many unique letters for a signature, or too many puzzle letters for the table. check the text.
+    // branch free over the letter pairs. any pair on the same side fails the word.
+    const auto text = reinterpret_cast<const uint8_t*>(str(word));
+    uint32_t same_side = 0;
+    uint32_t prev_side = side_map.side_of[text[0]];
+    for (uint32_t i = 1; i < uint32_t(word.length); ++i) {
+      const uint32_t side = side_map.side_of[text[i]];
+      same_side |= uint32_t(side == prev_side);
+      prev_side = side;
+    }
+    return !same_side;
+  }
+
+  uint32_t WordDB::collect_row_chunks(uint32_t letters, uint32_t chunk_size, RowChunk* chunks) const {
+    uint32_t chunk_count = 0;
+    for (uint32_t li = 0; li < 26; ++li) {
+      if (!(letters & (1u << li)) || words_by_letter[li] == WordIdx::kInvalid) {
+        continue;
+      }
+      const auto row_count = mem_stats.word_counts[li];
+      for (uint32_t b = 0; b < row_count; b += chunk_size) {
+        chunks[chunk_count++] = RowChunk{ li, b, std::min(b + chunk_size, row_count) };
+      }
+    }
+    return chunk_count;
+  }
+
+  WordDB WordDB::clone_packed(uint32_t thread_count) const {
+    return clone_packed(live_stats, nullptr, thread_count);
+  }
+
+  WordDB WordDB::clone_packed(const TextStats& keep_stats, const uint8_t* keep, uint32_t thread_count) const {
+    const uint64_t live_size = keep_stats.total_size_bytes();
+    const uint32_t live_count = keep_stats.total_count(); (void)live_count;
     BNG_VERIFY(
       *this &&
-      live_size < text_buf.capacity() &&
-      live_count < mem_stats.total_count(), "");
+      live_size <= text_buf.capacity() &&
+      live_count <= mem_stats.total_count(), "");
 
     WordDB out;
 
-    out.text_buf = TextBuf(live_size);
-    out.mem_stats = out.live_stats = live_stats;
-    out.words_buf = new Word[out.words_count()];
+    out.mem_stats = out.live_stats = keep_stats;
+    out.fingerprint = fingerprint;
+    out.use_huge_pages = use_huge_pages;
+    // null terminators are the zeroed Word.
+    out.text_buf = out.alloc_storage(live_size);
 
-    Word* wpo = out.words_buf;
-    uint32_t live_row_count = 0; (void)live_row_count;
-
-    for (uint32_t li = 0; li < 26; ++li) {
-      if (!live_stats.word_counts[li]) {
+    // every row's words and text go at offsets known up front, so rows pack independently.
+    uint64_t text_begin[26] = {};
+    uint64_t text_offset = 0;
+    for (uint32_t li = 0, word_begin = 0; li < 26; ++li) {
+      if (!keep_stats.word_counts[li]) {
         out.words_by_letter[li] = WordIdx::kInvalid;
         continue;
       }
+      out.words_by_letter[li] = WordIdx(word_begin);
+      text_begin[li] = text_offset;
+      word_begin += keep_stats.word_counts[li] + 1;
+      text_offset += keep_stats.size_bytes[li];
+    }
 
-      out.words_by_letter[li] = out.word_i(*wpo);
-      const auto wpo_row_start = wpo;
+    // a segment is based at the text of its first word. the words of a row ahead of the
+    // first segment starting in it belong to a segment that starts in an earlier row, so
+    // they are packed relative to the row's text and rebased once every base is known.
+    const uint32_t segment_mask = kSegmentWords - 1;
+    parallel_for_chunks(26, thread_count,
+      [&](uint32_t, uint32_t li) {
+        if (!keep_stats.word_counts[li]) {
+          return;
+        }
+        Word* wpo = out.first_word_rw(li);
+        const auto wpo_row_start = wpo;
+        uint64_t row_text_offset = text_begin[li];
+        uint64_t base = text_begin[li];
+        for (auto wp = first_word(li); *wp; wp++) {
+          if (keep ? keep[uint32_t(word_i(*wp))] : !wp->is_dead) {
+            const auto wio = uint32_t(wpo - out.words_buf);
+            if (!(wio & segment_mask)) {
+              base = out.segment_bases[wio >> kSegmentShift] = row_text_offset;
+            }
+            const auto wi = uint32_t(word_i(*wp));
+            out.pair_sigs_buf[wio] = pair_sigs_buf[wi];
+            out.letter_masks_buf[wio] = letter_masks_buf[wi];
+            out.last_letters_buf[wio] = last_letters_buf[wi];
+            *wpo++ = Word(*wp, uint32_t(row_text_offset - base));
+            memcpy(out.text_buf.begin() + row_text_offset, str(*wp), wp->length);
+            row_text_offset += wp->length;
+          }
+        }
+        // a segment starting on the null terminator starts with the next row's text.
+        const auto terminator_i = uint32_t(wpo - out.words_buf);
+        if (!(terminator_i & segment_mask)) {
+          out.segment_bases[terminator_i >> kSegmentShift] = row_text_offset;
+        }
+        const auto row_count = uint32_t(wpo - wpo_row_start); (void)row_count;
+        BNG_VERIFY(row_count == out.live_stats.word_counts[li], "");
+        BNG_VERIFY(row_text_offset - text_begin[li] == out.live_stats.size_bytes[li], "");
+        BNG_VERIFY(!*wpo, "word list for letter not null terminated.");
+      });
 
-      for (auto wp = first_word(li); *wp; wp++) {
-        if (!wp->is_dead) {
-          *wpo++ = out.text_buf.append(text_buf, *wp);
+    parallel_for_chunks(26, thread_count,
+      [&](uint32_t, uint32_t li) {
+        const auto row_begin = uint32_t(out.words_by_letter[li]);
+        if (!keep_stats.word_counts[li] || !(row_begin & segment_mask)) {
+          return;
         }
-      }
-      const auto row_count = uint32_t(wpo - wpo_row_start); (void)row_count;
-      BNG_VERIFY(row_count == out.live_stats.word_counts[li], "");
-      // null terminate
-      *wpo++ = Word();
-      ++live_row_count;
-    }
+        const uint64_t rebase = text_begin[li] - out.segment_bases[row_begin >> kSegmentShift];
+        const auto head_end = std::min((row_begin | segment_mask) + 1, row_begin + keep_stats.word_counts[li]);
+        for (uint32_t wi = row_begin; wi < head_end; ++wi) {
+          BNG_VERIFY(out.words_buf[wi].begin + rebase <= Word::kMaxBegin, "");
+          out.words_buf[wi].begin = out.words_buf[wi].begin + rebase;
+        }
+      });
 
-    const auto copy_count = uint32_t(wpo - out.words_buf); (void)copy_count;
-    BNG_VERIFY(copy_count == out.live_stats.total_count() + live_row_count, "");
+    if (class_index) {
+      out.build_class_index();
+    }
 
     return out;
   }
 
+  TextBuf WordDB::alloc_storage(uint64_t text_size) {
+    static_assert(std::is_trivially_copyable_v<Word> && PageBuf::kAlign % alignof(Word) == 0);
+    BNG_VERIFY(!words_buf && !arena, "");
+    // each array starts on a cache line. text is followed by 2 null bytes.
+    const auto align = [](uint64_t offset) { return (offset + PageBuf::kAlign - 1) & ~(PageBuf::kAlign - 1); };
+    const uint64_t pair_sigs_offset = align(words_size_bytes());
+    const uint64_t letter_masks_offset = align(pair_sigs_offset + pair_sigs_size_bytes());
+    const uint64_t last_letters_offset = align(letter_masks_offset + letter_masks_size_bytes());
+    const uint64_t segment_bases_offset = align(last_letters_offset + last_letters_size_bytes());
+    const uint64_t text_offset = align(segment_bases_offset + segment_bases_size_bytes());
+    arena = PageBuf(text_offset + text_size + 2, use_huge_pages);
+    words_buf = reinterpret_cast<Word*>(arena.data());
+    pair_sigs_buf = reinterpret_cast<uint64_t*>(arena.data() + pair_sigs_offset);
+    letter_masks_buf = reinterpret_cast<uint32_t*>(arena.data() + letter_masks_offset);
+    last_letters_buf = arena.data() + last_letters_offset;
+    segment_bases = reinterpret_cast<uint64_t*>(arena.data() + segment_bases_offset);
+    return TextBuf::view(reinterpret_cast<char*>(arena.data() + text_offset), text_size);
+  }
+
   void WordDB::clear_words_by_letter() {
     for (auto& wbl : words_by_letter) {
       wbl = WordIdx::kInvalid;
     }
   }
+
+  // cull and solve for every supported geometry.
+#define BNG_WORD_DB_INSTANTIATE(SIDE_COUNT, SIDE_WIDTH) \
+  template void WordDB::cull(const BasicSideSet<SIDE_COUNT, SIDE_WIDTH>&, uint32_t, SolveStats*); \
+  template WordDB WordDB::culled(const BasicSideSet<SIDE_COUNT, SIDE_WIDTH>&, SolveStats*) const; \
+  template SolutionSet WordDB::solve(const BasicSideSet<SIDE_COUNT, SIDE_WIDTH>&, uint32_t, SolveStats*) const; \
+  template uint32_t WordDB::puzzle_letters(const BasicSideSet<SIDE_COUNT, SIDE_WIDTH>&);
+  BNG_WORD_DB_GEOMETRIES(BNG_WORD_DB_INSTANTIATE)
+#undef BNG_WORD_DB_INSTANTIATE
 }
@@ -1,5 +1,9 @@
 #pragma once
 #include "core/core.h"
+#include "core/mapped_file.h"
+#include "core/page_buf.h"
+#include "core/timers.h"
+#include <span>
 
 namespace bng::word_db {
   using namespace core;
@@ -7,11 +11,14 @@ namespace bng::word_db {
 
   class TextBuf;
   class WordDB;
+  class LetterMaskRows;
+  class WordClassIndex;
+  struct ScannedWord;
 
 
   struct TextStats {
     uint32_t word_counts[26] = {};
-    uint32_t size_bytes[26] = {};
+    uint64_t size_bytes[26] = {};
 
     operator bool() const {
       for (auto wc : word_counts) {
@@ -34,8 +41,8 @@ namespace bng::word_db {
       return tc;
     }
 
-    uint32_t total_size_bytes() const {
-      uint32_t tsb = 0;
+    uint64_t total_size_bytes() const {
+      uint64_t tsb = 0;
       for (auto sb : size_bytes) {
         tsb += sb;
       }
@@ -45,7 +52,13 @@ namespace bng::word_db {
 
 
   struct Word {
-    uint64_t begin : 26 = 0;
+    static constexpr uint32_t kBeginBits = 26;
+    static constexpr uint64_t kMaxBegin = (1ull << kBeginBits) - 1;
+    // unique letters of the largest board. words with more can't be played on any board.
+    static constexpr uint32_t kMaxLetterCount = 24;
+
+    // text offset from the base of the word's segment. see WordDB::text_offset.
+    uint64_t begin : kBeginBits = 0;
     uint64_t length : 6 = 0;
     uint64_t letters : 26 = 0;
     uint64_t letter_count : 5 = 0;
@@ -62,6 +75,9 @@ namespace bng::word_db {
       this->begin = new_begin;
     }
 
+    // same fields read_str would produce for the word's text.
+    explicit Word(const ScannedWord& sw);
+
     uint32_t read_str(const char* buf_start, const char* p);
     inline uint32_t read_str(const TextBuf& buf, const char* p);
 
@@ -92,6 +108,24 @@ namespace bng::word_db {
     }
 
     static void letters_to_str(uint64_t letter_bits, char* pout);
+
+    // unique letters a pair signature can encode. 11 letters have 55 rank pairs.
+    static constexpr uint32_t kMaxPairSigLetters = 11;
+
+    // one bit per unordered pair of adjacent letters. letters are numbered by
+    // their rank in the letters mask, so the signature is puzzle independent.
+    // 0 if the word has too many unique letters to encode.
+    uint64_t pair_sig(const char* str) const;
+
+    static uint64_t rank_pair_bit(uint32_t r0, uint32_t r1) {
+      const auto lo = r0 < r1 ? r0 : r1;
+      const auto hi = r0 < r1 ? r1 : r0;
+      return 1ull << (hi * (hi - 1) / 2 + lo);
+    }
+
+    uint32_t letter_rank(uint32_t letter_bit) const {
+      return count_bits(uint32_t(letters) & (letter_bit - 1));
+    }
   };
 
 
@@ -99,12 +133,24 @@ namespace bng::word_db {
   public:
     BNG_DECL_NO_COPY_IMPL_MOVE(TextBuf);
 
-    explicit TextBuf(uint32_t sz = 0);
+    explicit TextBuf(uint64_t sz = 0);
+
+    // non-owning view of size bytes of text followed by 2 null bytes.
+    static TextBuf view(char* text, uint64_t size) {
+      TextBuf buf;
+      buf._text = text;
+      buf._capacity = buf._size = size;
+      buf._is_view = true;
+      return buf;
+    }
 
-    Word append(const TextBuf& src, const Word& w);
+    // read only text, e.g. a mapped image. never written through the view.
+    static TextBuf view(const char* text, uint64_t size) {
+      return view(const_cast<char*>(text), size);
+    }
 
-    uint32_t capacity() const { return _capacity; }
-    uint32_t size() const { return _size; }
+    uint64_t capacity() const { return _capacity; }
+    uint64_t size() const { return _size; }
     char* begin() { return _text; }
     char* front() { return _text; }
     const char* begin() const { return _text; }
@@ -112,7 +158,7 @@ namespace bng::word_db {
     char* end() { return _text + _size; }
     const char* end() const { return _text + _size; }
 
-    void set_size(uint32_t new_size_bytes) {
+    void set_size(uint64_t new_size_bytes) {
       BNG_VERIFY(new_size_bytes <= _capacity, "");
       _size = new_size_bytes;
     }
@@ -125,10 +171,9 @@ namespace bng::word_db {
       return p < (_text + _capacity);
     }
 
-    // format example: printf("%.*s", w.length, buf.ptr(w));
-    const char* ptr(const Word& w) const {
-      BNG_VERIFY(w.begin < _size, "word out of range");
-      return _text + w.begin;
+    const char* ptr(uint64_t offset) const {
+      BNG_VERIFY(offset < _size, "offset out of range");
+      return _text + offset;
     }
 
     operator bool() const {
@@ -141,16 +186,23 @@ namespace bng::word_db {
 
     TextStats collect_stats() const;
 
+    // stats of the words in [p, p_end), in any order. p must be at the start of a word.
+    // at most 4GB at a time.
+    TextStats collect_stats(const char* p, const char* p_end) const;
+
     ~TextBuf() {
-      delete[] _text;
+      if (!_is_view) {
+        delete[] _text;
+      }
       _text = nullptr;
       _capacity = 0;
     }
 
   private:
-    uint32_t _capacity = 0;
-    uint32_t _size = 0;
+    uint64_t _capacity = 0;
+    uint64_t _size = 0;
     char* _text = nullptr;
+    bool _is_view = false;
   };
 
 
@@ -162,6 +214,43 @@ namespace bng::word_db {
   enum class WordIdx : uint32_t { kInvalid = ~0u };
 
 
+  // the sides of a puzzle with SIDE_COUNT sides of SIDE_WIDTH letters, every letter different.
+  // the geometry is part of the type, so cull and solve are compiled for each one and the
+  // classic 4 x 3 board keeps its constant folded path. see BNG_WORD_DB_GEOMETRIES.
+  template<uint32_t SIDE_COUNT, uint32_t SIDE_WIDTH>
+  struct BasicSideSet : std::array<Word, SIDE_COUNT> {
+    static constexpr uint32_t kSideCount = SIDE_COUNT;
+    static constexpr uint32_t kSideWidth = SIDE_WIDTH;
+    static constexpr uint32_t kLetterCount = SIDE_COUNT * SIDE_WIDTH;
+    static_assert(SIDE_COUNT >= 2 && SIDE_WIDTH >= 1 && kLetterCount <= Word::kMaxLetterCount, "sides must fit in the alphabet");
+
+    // the same puzzle however it was listed, e.g. "vrq wue isl dmo" and "dmo isl wue qrv".
+    // each side is rebuilt from its letters in alphabetical order, then the sides are
+    // sorted. sides don't share letters, so their first letters order them.
+    BasicSideSet canonical() const {
+      BasicSideSet out;
+      for (uint32_t si = 0; si < SIDE_COUNT; ++si) {
+        char letters_str[27] = {};
+        Word::letters_to_str((*this)[si].letters, letters_str);
+        out[si] = Word(letters_str);
+      }
+      auto first_letter = [](const Word& side) {
+        return std::countr_zero(uint32_t(side.letters));
+      };
+      for (uint32_t si = 1; si < SIDE_COUNT; ++si) {
+        for (uint32_t sj = si; sj > 0 && first_letter(out[sj]) < first_letter(out[sj - 1]); --sj) {
+          std::swap(out[sj], out[sj - 1]);
+        }
+      }
+      return out;
+    }
+  };
+
+  // geometries WordDB::cull, culled, solve and puzzle_letters are compiled for, as X(SIDE_COUNT, SIDE_WIDTH).
+#define BNG_WORD_DB_GEOMETRIES(X) \
+  X(4, 3) X(3, 3) X(5, 3) X(6, 3) X(3, 4) X(4, 4) X(5, 4) X(6, 4)
+
+
   struct Solution {
     WordIdx a = WordIdx::kInvalid;
     WordIdx b = WordIdx::kInvalid;
@@ -184,9 +273,13 @@ namespace bng::word_db {
       _size = _capacity = 0;
     }
 
+    // producers size the set exactly, from a count or a SolutionBlocks. a miscount
+    // fails the VERIFY and in release builds drops the solution instead of writing past the end.
     void add(WordIdx a, WordIdx b) {
       BNG_VERIFY(_size < _capacity, "out of space");
-      buf[_size++] = Solution{ a, b };
+      if (_size < _capacity) {
+        buf[_size++] = Solution{ a, b };
+      }
     }
 
     const Solution* begin() const { return buf; }
@@ -195,6 +288,11 @@ namespace bng::word_db {
     Solution* begin() { return buf; }
     Solution* end() { return buf + _size; }
 
+    void set_size(uint32_t new_size) {
+      BNG_VERIFY(new_size <= _capacity, "out of space");
+      _size = new_size <= _capacity ? new_size : _capacity;
+    }
+
     const Solution& front() const { return *buf; }
     const Solution& back() const { return *(buf + _size); }
 
@@ -206,6 +304,8 @@ namespace bng::word_db {
       return _size;
     }
 
+    // shortest total length first. ties in word order, so the order is the same however
+    // the solutions were found.
     void sort(const WordDB& wordDB);
 
   private:
@@ -215,18 +315,197 @@ namespace bng::word_db {
   };
 
 
+  // solutions collected a fixed size block at a time, for solvers that don't know how many
+  // they will find. blocks never move, so adding never reallocates or copies and memory
+  // follows the solutions found. the blocks are copied once into an exactly sized SolutionSet.
+  class SolutionBlocks {
+  public:
+    BNG_DECL_NO_COPY_IMPL_MOVE(SolutionBlocks);
+
+    static constexpr uint32_t kBlockSize = 1024;
+
+    SolutionBlocks() = default;
+
+    ~SolutionBlocks() {
+      for (uint32_t bi = 0; bi < block_count; ++bi) {
+        delete[] blocks[bi];
+      }
+      delete[] blocks;
+      blocks = nullptr;
+      block_count = block_capacity = tail_size = 0;
+    }
+
+    void add(WordIdx a, WordIdx b) {
+      if (!block_count || tail_size == kBlockSize) {
+        add_block();
+      }
+      blocks[block_count - 1][tail_size++] = Solution{ a, b };
+    }
+
+    uint64_t size() const {
+      return block_count ? uint64_t(block_count - 1) * kBlockSize + tail_size : 0;
+    }
+
+    // every solution in the order they were added. out must have room for size().
+    void copy_to(Solution* out) const;
+
+  private:
+    void add_block();
+
+  private:
+    Solution** blocks = nullptr;
+    uint32_t block_count = 0;
+    uint32_t block_capacity = 0;
+    uint32_t tail_size = 0;
+  };
+
+
+  // ranks solutions for WordDB::solve_top_k. lower scores are better.
+  struct SolutionScorer {
+    // score of the solution a -> b.
+    using ScoreFn = uint32_t(*)(const WordDB& db, const Word& a, const Word& b, const void* context);
+    // no solution starting with a scores lower, given b is at least min_b_length letters.
+    // lets solve_top_k skip a without matching it against any b.
+    using BoundFn = uint32_t(*)(const WordDB& db, const Word& a, uint32_t min_b_length, const void* context);
+
+    ScoreFn score = nullptr;
+    // optional. without it every candidateA is matched.
+    BoundFn bound = nullptr;
+    const void* context = nullptr;
+
+    // letters in both words, the order of SolutionSet::sort.
+    static SolutionScorer total_length();
+  };
+
+
+  // where cull and solve spend their work. only counted in builds with BNG_SOLVE_STATS
+  // (the BNG_SOLVE_STATS cmake option). otherwise the counting compiles away and counts stay 0.
+  struct SolveStats {
+#if defined(BNG_SOLVE_STATS)
+    static constexpr bool kIsEnabled = true;
+#else
+    static constexpr bool kIsEnabled = false;
+#endif
+
+    // cull. rows of letters not in the puzzle count as foreign letter rejects without being tested.
+    uint64_t words_tested = 0;
+    uint64_t foreign_letter_rejects = 0;
+    uint64_t same_side_rejects = 0;
+
+    // solve. candidateA words matched against a row of candidateB words,
+    // the candidateB words they were compared with and the solutions in each candidateB row.
+    uint64_t candidates_a = 0;
+    uint64_t pairs_compared = 0;
+    uint64_t row_hits[26] = {};
+
+    uint64_t hit_count() const {
+      uint64_t total = 0;
+      for (auto h : row_hits) {
+        total += h;
+      }
+      return total;
+    }
+
+    SolveStats& operator +=(const SolveStats& rhs) {
+      words_tested += rhs.words_tested;
+      foreign_letter_rejects += rhs.foreign_letter_rejects;
+      same_side_rejects += rhs.same_side_rejects;
+      candidates_a += rhs.candidates_a;
+      pairs_compared += rhs.pairs_compared;
+      for (uint32_t li = 0; li < 26; ++li) {
+        row_hits[li] += rhs.row_hits[li];
+      }
+      return *this;
+    }
+  };
+
+
+  struct Chain {
+    static constexpr uint32_t kMaxWords = 5;
+
+    WordIdx words[kMaxWords] = {
+      WordIdx::kInvalid, WordIdx::kInvalid, WordIdx::kInvalid, WordIdx::kInvalid, WordIdx::kInvalid
+    };
+    uint32_t count = 0;
+  };
+
+
+  struct ChainSet {
+    BNG_DECL_NO_COPY_IMPL_MOVE(ChainSet);
+
+    ChainSet() = default;
+
+    ~ChainSet() {
+      delete[] buf;
+      buf = nullptr;
+      _size = _capacity = 0;
+    }
+
+    void add(const Chain& chain) {
+      if (_size == _capacity) {
+        grow();
+      }
+      buf[_size++] = chain;
+    }
+
+    const Chain* begin() const { return buf; }
+    const Chain* end() const { return buf + _size; }
+
+    Chain* begin() { return buf; }
+    Chain* end() { return buf + _size; }
+
+    size_t size() const {
+      return _size;
+    }
+
+    // number of words in every chain of the set. 0 if empty.
+    uint32_t word_count() const {
+      return _size ? buf->count : 0;
+    }
+
+    // shortest total length first. ties by word indices in chain order, so the order is
+    // the same however the chains were found.
+    void sort(const WordDB& wordDB);
+
+  private:
+    void grow();
+
+  private:
+    Chain* buf = nullptr;
+    uint32_t _size = 0;
+    uint32_t _capacity = 0;
+  };
+
+
   class WordDB {
   public:
     BNG_DECL_NO_COPY_IMPL_MOVE(WordDB);
 
-    using SideSet = std::array<Word, 4>;
+    // the classic board. solve_complement, solve_n, solve_top_k and count_solutions only take this one.
+    using SideSet = BasicSideSet<4, 3>;
+
+    // Word::begin only reaches 64MB. words are grouped in segments of kSegmentWords
+    // by index and each segment has a 64 bit base offset into the text, so the text
+    // can be any size while Word stays 8 bytes.
+    static constexpr uint32_t kSegmentShift = 16;
+    static constexpr uint32_t kSegmentWords = 1u << kSegmentShift;
 
     WordDB() = default;
 
-    explicit WordDB(const std::filesystem::path& path);
+    // thread_count is used to preprocess .txt word lists. 0 uses all hardware threads.
+    explicit WordDB(const std::filesystem::path& path, uint32_t thread_count = 1);
+
+    // one db from several .txt word lists. see load(paths).
+    explicit WordDB(std::span<const std::filesystem::path> paths, uint32_t thread_count = 1);
 
     ~WordDB();
 
+    // non-owning view of a .pre file image already in memory, e.g. one compiled into
+    // the executable. image must be 8 byte aligned and outlive the db.
+    // empty if the image is not a valid .pre file. skipping the checksum avoids
+    // touching every page of an image that can't have been corrupted on disk.
+    static WordDB view(const uint8_t* image, uint64_t size, bool verify_checksum = true);
+
     uint32_t size() const {
       BNG_VERIFY(mem_stats.total_count() == live_stats.total_count(), "");
       return live_stats.total_count();
@@ -240,16 +519,83 @@ namespace bng::word_db {
       return !words_buf;
     }
 
-    bool load(const std::filesystem::path& path);
+    // thread_count is used to preprocess .txt word lists. 0 uses all hardware threads.
+    // word lists may be in any order and any case, with duplicates. the db is the same
+    // as for the sorted, lower case list of unique words.
+    bool load(const std::filesystem::path& path, uint32_t thread_count = 1);
+
+    // merges .txt word lists into one db, dropping words that are in more than one.
+    // each list is read and sorted on its own, so they are never all in memory as raw text.
+    bool load(std::span<const std::filesystem::path> paths, uint32_t thread_count = 1);
 
     void save(const std::filesystem::path& path);
 
-    void cull(const SideSet& sides);
+    // thread_count 0 uses all hardware threads.
+    // a view is replaced by culled(sides) instead of being modified in place.
+    // stats, when not null, are added to. see SolveStats.
+    template<uint32_t SIDE_COUNT, uint32_t SIDE_WIDTH>
+    void cull(const BasicSideSet<SIDE_COUNT, SIDE_WIDTH>& sides, uint32_t thread_count = 1, SolveStats* stats = nullptr);
+
+    // packed copy with only the words playable for sides. leaves this db as is,
+    // so one loaded db can serve many puzzles.
+    template<uint32_t SIDE_COUNT, uint32_t SIDE_WIDTH>
+    WordDB culled(const BasicSideSet<SIDE_COUNT, SIDE_WIDTH>& sides, SolveStats* stats = nullptr) const;
+
+    // thread_count 0 uses all hardware threads.
+    // stats are not collected when a class index is built.
+    template<uint32_t SIDE_COUNT, uint32_t SIDE_WIDTH>
+    SolutionSet solve(const BasicSideSet<SIDE_COUNT, SIDE_WIDTH>& sides, uint32_t thread_count = 1, SolveStats* stats = nullptr) const;
+
+    // same solutions as solve(), found by looking up the words that supply each word's
+    // missing letters in a 12-bit puzzle letter superset table instead of scanning rows.
+    SolutionSet solve_complement(const SideSet& sides) const;
+
+    // shortest chains of up to max_words (<= Chain::kMaxWords) words that use all puzzle letters.
+    // like solve(), expects the db to have been culled for sides.
+    ChainSet solve_n(const SideSet& sides, uint32_t max_words) const;
 
-    SolutionSet solve(const SideSet& sides) const;
+    // the k lowest scoring solve() solutions, best first. ties go to the lower word indices.
+    // solutions are kept in a k entry heap and never all collected. candidateA words are
+    // tried in order of their bound, so the search ends at the first one that can't beat
+    // the worst solution in a full heap. like solve(), expects the db to have been culled for sides.
+    SolutionSet solve_top_k(
+      const SideSet& sides, uint32_t k, const SolutionScorer& scorer = SolutionScorer::total_length()) const;
+
+    // number of solve() solutions without materializing them.
+    uint64_t count_solutions(const SideSet& sides) const;
+
+    // optional index of (first letter, last letter, letter mask) word classes.
+    // when built, solve() pairs classes instead of words. cull() and culled()
+    // rebuild it for the packed copy so it only has to be requested once.
+    void build_class_index();
+
+    const WordClassIndex* get_class_index() const {
+      return class_index;
+    }
+
+    // back the storage of dbs loaded, culled or cloned from now on with transparent huge pages,
+    // where the os supports them. culled copies inherit it. fewer TLB misses when solve
+    // jumps between rows of a large db.
+    void set_use_huge_pages(bool use) {
+      use_huge_pages = use;
+    }
+
+    // the storage is mapped on huge page boundaries. only dbs of at least a huge page are.
+    bool is_huge_page_aligned() const {
+      return arena.is_huge_page_aligned();
+    }
+
+    // all puzzle letters as a bit mask, 0 if sides are not a valid puzzle.
+    template<uint32_t SIDE_COUNT, uint32_t SIDE_WIDTH>
+    static uint32_t puzzle_letters(const BasicSideSet<SIDE_COUNT, SIDE_WIDTH>& sides);
 
     bool is_equivalent(const WordDB& rhs) const;
 
+    // identifies the source dictionary. saved with and loaded from .pre files.
+    uint64_t get_fingerprint() const {
+      return fingerprint;
+    }
+
     const TextStats& get_text_stats() const {
       return live_stats;
     }
@@ -258,17 +604,41 @@ namespace bng::word_db {
       return text_buf;
     }
 
+    uint64_t text_offset(const Word& w) const {
+      return segment_bases[uint32_t(word_i(w)) >> kSegmentShift] + w.begin;
+    }
+
     // format example: printf("%.*s", w.length, word_db.str(w));
     const char* str(const Word& w) const {
-      return text_buf.ptr(w);
+      return text_buf.ptr(text_offset(w));
     }
 
     uint32_t first_letter_idx(const Word& w) const {
-      return Word::letter_to_idx(text_buf.ptr(w)[0]);
+      return Word::letter_to_idx(str(w)[0]);
     }
 
     uint32_t last_letter_idx(const Word& w) const {
-      return Word::letter_to_idx(text_buf.ptr(w)[(w.length - 1)]);
+      return last_letters_buf[uint32_t(word_i(w))];
+    }
+
+    // Word::letters of the word, from a column parallel to the words.
+    uint32_t letter_mask(WordIdx i) const {
+      BNG_VERIFY(uint32_t(i) < words_count(), "");
+      return letter_masks_buf[uint32_t(i)];
+    }
+
+    // the letter mask column of the row of words starting with letter_i, row_size entries long.
+    // loops that only need the letters stream it instead of the words.
+    const uint32_t* row_letter_masks(uint32_t letter_i) const {
+      BNG_VERIFY(letter_i < 26, "invalid letter index");
+      return (words_by_letter[letter_i] != WordIdx::kInvalid) ? letter_masks_buf + uint32_t(words_by_letter[letter_i]) : nullptr;
+    }
+
+    // words in the row starting with letter_i, not counting the null terminator.
+    // includes words culled in place that were not packed away yet.
+    uint32_t row_size(uint32_t letter_i) const {
+      BNG_VERIFY(letter_i < 26, "invalid letter index");
+      return (words_by_letter[letter_i] != WordIdx::kInvalid) ? mem_stats.word_counts[letter_i] : 0;
     }
 
     WordIdx word_i(const Word& w) const {
@@ -281,6 +651,9 @@ namespace bng::word_db {
       return (i != WordIdx::kInvalid) ? (words_buf + uint32_t(i)) : nullptr;
     }
 
+    // the word spelled text, by binary search of its row. kInvalid if the db doesn't have it.
+    WordIdx find_word(const char* text, uint32_t length) const;
+
     const Word* first_word(uint32_t letter_i) const {
       BNG_VERIFY(letter_i < 26, "invalid letter index");
       return word(words_by_letter[letter_i]);
@@ -295,32 +668,177 @@ namespace bng::word_db {
   private:
     void load_preproc(const std::filesystem::path& path);
 
+    // points the db into a .pre image. false and untouched if the image is invalid.
+    bool attach_preproc(const uint8_t* image, uint64_t size, const char* name, bool verify_checksum = true);
+
     void save_preproc(const std::filesystem::path& path) const;
 
-    void load_word_list(const std::filesystem::path& path);
+    void load_word_lists(std::span<const std::filesystem::path> paths, uint32_t thread_count);
+
+    // the file's text lower cased. empty if it can't be read.
+    // chains the file's hash into fingerprint.
+    TextBuf read_word_list(const std::filesystem::path& path, uint32_t thread_count);
+
+    // sorts text_buf first if it is out of order.
+    void process_word_list(uint32_t thread_count);
+
+    static void fold_case(TextBuf& text, uint32_t thread_count);
+
+    // true if the live words of text are in strictly increasing order, so there are no duplicates.
+    static bool is_sorted_word_list(const TextBuf& text, uint32_t thread_count);
+
+    // the live words of text sorted and without duplicates, one per line.
+    static TextBuf sort_word_list(const TextBuf& text, uint32_t thread_count);
+
+    // streaming k-way merge of sorted runs into one word list, without duplicates.
+    // runs are read from their start a block at a time. size_bytes is their total size.
+    static TextBuf merge_word_lists(File* runs, uint32_t run_count, uint64_t size_bytes);
+
+    // a word in a word list that has not been collated yet.
+    struct WordRef {
+      const char* text = nullptr;
+      uint32_t length = 0;
+    };
 
-    void process_word_list();
+    static int compare(const WordRef& lhs, const WordRef& rhs, uint32_t depth = 0) {
+      const uint32_t min_length = lhs.length < rhs.length ? lhs.length : rhs.length;
+      const int cmp = (min_length > depth) ? memcmp(lhs.text + depth, rhs.text + depth, min_length - depth) : 0;
+      return cmp ? cmp : int(lhs.length) - int(rhs.length);
+    }
+
+    // a span of the word list text starting and ending on word boundaries.
+    // the unit of work for threaded preprocessing.
+    struct TextChunk {
+      const char* begin = nullptr;
+      const char* end = nullptr;
+      // live words only. dead words are dropped while collating.
+      TextStats stats;
+      // the chunk's live words are in strictly increasing order. its first and last
+      // live words are kept to check the order across chunks.
+      bool is_sorted = true;
+      WordRef first;
+      WordRef last;
+      // where the chunk's first word of each letter and its text go in the packed db.
+      uint32_t word_begin[26] = {};
+      uint64_t text_begin[26] = {};
+    };
+
+    static uint32_t collect_text_chunks(const TextBuf& text, uint32_t chunk_size, TextChunk* chunks);
+
+    // stats and order of the chunk's live words.
+    static void collect_live_stats(TextChunk& chunk);
+
+    static bool is_sorted(const TextChunk* chunks, uint32_t chunk_count);
 
-    void collate_words();
+    void collate_words(TextChunk* chunks, uint32_t chunk_count, uint32_t thread_count);
 
-    WordDB clone_packed() const;
+    WordDB clone_packed(uint32_t thread_count = 1) const;
+
+    // packed copy of the words with keep[word index] set.
+    // rows are packed concurrently with thread_count threads.
+    WordDB clone_packed(const TextStats& keep_stats, const uint8_t* keep, uint32_t thread_count = 1) const;
 
     void cull_word(Word& word);
 
-    static uint32_t header_size_bytes() {
-      return offsetof(WordDB, text_buf);
+    // per puzzle side of every character. two letters on the same side can't follow
+    // each other, so checking a word is one table compare per letter pair.
+    // with a pair signature it is one table lookup per word. the lookup table has an entry
+    // per subset of the puzzle letters, so boards of more than 12 letters go without it.
+    template<typename Sides>
+    struct SideMap {
+      static constexpr bool kHasPairTable = Sides::kLetterCount <= 12;
+      // table sizes. 1 without the table.
+      static constexpr uint32_t kLocalCount = kHasPairTable ? Sides::kLetterCount : 1;
+      static constexpr uint32_t kByteCount = kHasPairTable ? 256 : 1;
+
+      explicit SideMap(const Sides& sides);
+
+      void build_pair_table(const Sides& sides);
+
+      // puzzle letters of letters remapped to bits 0 to kLocalCount - 1.
+      uint32_t local_mask(uint32_t letters) const {
+        static_assert(kHasPairTable);
+        return
+          local_of_byte[0][letters & 0xff] | local_of_byte[1][(letters >> 8) & 0xff] |
+          local_of_byte[2][(letters >> 16) & 0xff] | local_of_byte[3][letters >> 24];
+      }
+
+      // rank pairs of a word's letters that share a side, in Word::pair_sig bit layout.
+      // letters must only use puzzle letters.
+      uint64_t same_side_pairs(uint32_t letters) const {
+        return same_side_rank_pairs[local_mask(letters)];
+      }
+
+      uint32_t all_letters = 0;
+      // side index + 1 for puzzle letters, 0 for any other character.
+      uint8_t side_of[256] = {};
+      uint16_t local_of_byte[4][kByteCount] = {};
+      // indexed by local letter mask.
+      uint64_t same_side_rank_pairs[1u << kLocalCount] = {};
+    };
+
+    template<typename Sides>
+    bool is_playable(const Word& word, const SideMap<Sides>& side_map) const;
+
+    // solve() once the sides are checked and reduced to their letters.
+    SolutionSet solve_letters(uint32_t all_letters, uint32_t thread_count, SolveStats* stats) const;
+
+    uint64_t pair_sig(const Word& w) const {
+      return pair_sigs_buf[uint32_t(word_i(w))];
+    }
+
+    // candidateA words [wia, wia_end).
+    void solve_range(
+      uint32_t wia, uint32_t wia_end, uint32_t all_letters,
+      const LetterMaskRows& mask_rows, uint32_t* hits, SolutionBlocks& solutions, SolveStats* stats) const;
+
+    // a slice of one first letter row, the unit of work for threaded cull and solve.
+    struct RowChunk {
+      uint32_t letter_i = 0;
+      uint32_t begin = 0;
+      uint32_t end = 0;
+    };
+
+    uint32_t collect_row_chunks(uint32_t letters, uint32_t chunk_size, RowChunk* chunks) const;
+
+    static uint32_t max_row_chunks(uint32_t words_count, uint32_t chunk_size) {
+      return words_count / chunk_size + 26;
     }
 
     uint32_t words_count() const {
       return uint32_t(mem_stats.total_count(/*null_terminated*/true));
     }
 
-    uint32_t words_size_bytes() const {
-      return uint32_t(sizeof(Word) * words_count());
+    uint64_t words_size_bytes() const {
+      return sizeof(Word) * uint64_t(words_count());
+    }
+
+    uint64_t pair_sigs_size_bytes() const {
+      return sizeof(uint64_t) * uint64_t(words_count());
+    }
+
+    uint64_t letter_masks_size_bytes() const {
+      return sizeof(uint32_t) * uint64_t(words_count());
+    }
+
+    uint64_t last_letters_size_bytes() const {
+      return sizeof(uint8_t) * uint64_t(words_count());
+    }
+
+    uint32_t segment_count() const {
+      return (words_count() + kSegmentWords - 1) >> kSegmentShift;
+    }
+
+    uint64_t segment_bases_size_bytes() const {
+      return sizeof(uint64_t) * uint64_t(segment_count());
     }
 
     void clear_words_by_letter();
 
+    // words, their columns and segment bases for mem_stats and text_size bytes of text,
+    // all zeroed in one arena allocation. returns the text.
+    TextBuf alloc_storage(uint64_t text_size);
+
     Word& word_rw(WordIdx i) {
       BNG_VERIFY(i != WordIdx::kInvalid, "");
       return words_buf[uint32_t(i)];
@@ -332,12 +850,30 @@ namespace bng::word_db {
     }
 
   private:
+    // members here through segment_bases are saved in .pre files.
     TextStats mem_stats;
     WordIdx words_by_letter[26] = {};
-    // members here and before serialized in .pre files
+    // the text of every word, back to back in word order.
     TextBuf text_buf;
     Word* words_buf = nullptr;
-    // members here and below do not get serialized.
+    // Word::pair_sig of each word, parallel to words_buf.
+    uint64_t* pair_sigs_buf = nullptr;
+    // Word::letters and the index of the last letter of each word, parallel to words_buf,
+    // so cull and solve stream 5 bytes per word instead of the Word bit fields and text.
+    uint32_t* letter_masks_buf = nullptr;
+    uint8_t* last_letters_buf = nullptr;
+    // text offset each segment's Word::begin is relative to.
+    uint64_t* segment_bases = nullptr;
+    // hash of the dictionary text the words came from.
+    uint64_t fingerprint = 0;
+    // a db loaded from .pre points into the mapping instead of owning its buffers.
+    core::MappedFile mapping;
+    // buffers point into a .pre image, mapped or not. they are never written.
+    bool is_view = false;
+    // otherwise they point into the arena.
+    core::PageBuf arena;
+    bool use_huge_pages = false;
     TextStats live_stats;
+    WordClassIndex* class_index = nullptr;
   };
 } // namespace bng::word_db
@@ -1,4 +1,5 @@
 #include "word_db_std.h"
+#include "text_kernel.h"
 #include <algorithm>
 #include <sstream>
 #include <fstream>
@@ -28,6 +29,14 @@ namespace bng::word_db_std {
     return i - offset;
   }
 
+  Word::Word(const ScannedWord& sw) {
+    begin = sw.begin;
+    length = sw.length;
+    letters = sw.letters;
+    letter_count = sw.letter_count();
+    is_dead = ((sw.length > 0x3f) || length < 3 || letter_count > 12 || sw.has_double);
+  }
+
   void Word::letters_to_str(uint64_t letter_bits, char* pout) {
     for (uint32_t li = 0; letter_bits && li < 26; ++li) {
       const auto lb = (1ull << li);
@@ -45,7 +54,7 @@ namespace bng::word_db_std {
   // 
 
   Word TextBuf::append(const TextBuf& src, const Word& w) {
-    BNG_VERIFY(size() + w.length < capacity(), "");
+    BNG_VERIFY(size() + w.length <= capacity(), "");
     auto new_word = Word(w, uint32_t(size()));
     resize(size() + w.length);
     memcpy(data() + size() - w.length, src.ptr(w), w.length);
@@ -57,6 +66,8 @@ namespace bng::word_db_std {
   //
 
   void SolutionSet::sort(const WordDB& wordDB) {
+    auto _trace = BNG_TRACE_SCOPE("std sort");
+    auto _timer = BNG_TIMED_SCOPE("std sort");
     std::sort(
       begin(),
       end(),
@@ -80,6 +91,8 @@ namespace bng::word_db_std {
   }
 
   bool WordDB::load(const std::filesystem::path& path) {
+    auto _trace = BNG_TRACE_SCOPE("std load");
+    auto _timer = BNG_TIMED_SCOPE("std load");
     BNG_VERIFY(!path.empty(), "invalid path");
     BNG_VERIFY(!*this, "already loaded.");
 
@@ -106,6 +119,8 @@ namespace bng::word_db_std {
   }
 
   void WordDB::cull(const SideSet& sides) {
+    auto _trace = BNG_TRACE_SCOPE("std cull");
+    auto _timer = BNG_TIMED_SCOPE("std cull");
     uint32_t all_letters = 0;
     for (auto s : sides) {
       all_letters |= s.letters;
@@ -155,6 +170,8 @@ namespace bng::word_db_std {
   }
 
   SolutionSet WordDB::solve(const SideSet& sides) const {
+    auto _trace = BNG_TRACE_SCOPE("std solve");
+    auto _timer = BNG_TIMED_SCOPE("std solve");
     uint32_t all_letters = 0;
     uint32_t all_letter_count = 0;
     char letters_str[27] = {};
@@ -192,7 +209,7 @@ namespace bng::word_db_std {
         // run through all words starting with the last letter of candidateA - these are candidateB
         const auto bli = last_letter_idx(*wpa);
         for (auto wpb = first_word(bli); wpb && *wpb; ++wpb) {
-          const auto hit_letters = wpa->letters | wpb->letters;
+          const auto hit_letters = uint32_t(wpa->letters | wpb->letters);
           if (hit_letters == all_letters) {
             solutions.add(word_i(*wpa), word_i(*wpb));
           }
@@ -290,18 +307,14 @@ namespace bng::word_db_std {
     BNG_VERIFY(*this, "");
     auto stats = TextStats{};
    
-    for (size_t i = 0, e = size(); i < e; ) {
-      const auto iw = i;
-      auto li = Word::letter_to_idx((*this)[i]);
-      ++stats.word_counts[li];
-      // catch out of order dictionary
-      BNG_VERIFY(li == 25 || !stats.word_counts[li + 1], "");
-      for (; !Word::is_end((*this)[i]); ++i)
-        ;
-      for (; i < e && Word::is_end((*this)[i]); ++i)
-        ;
-      stats.size_bytes[li] += uint32_t(i - iw);
-    }
+    word_db::scan_words(data(), 0, uint32_t(size()),
+      [&](const ScannedWord& sw) {
+        auto li = sw.first_letter;
+        ++stats.word_counts[li];
+        // catch out of order dictionary
+        BNG_VERIFY(li == 25 || !stats.word_counts[li + 1], "");
+        stats.size_bytes[li] += sw.span;
+      });
 
     return stats;
   }
@@ -318,32 +331,33 @@ namespace bng::word_db_std {
 
     size_t i = 0;
     const auto& tb = text_buf.as_string();
-    const size_t te = tb.size();
 
-    for (; i < te; ) {
-      auto li = Word::letter_to_idx(tb[i]);
-      if (words_by_letter[li] == WordIdx::kInvalid) {
-        if (li) {
-          // null terminate
-          words_buf.emplace_back();
-          const auto row_total_count = uint32_t(words_buf.size() - wi_row_start); (void)row_total_count;
-          BNG_VERIFY(row_total_count == mem_stats.word_counts[li - 1] + 1, "");
-          live_stats.word_counts[li - 1] = row_live_count;
-          live_stats.size_bytes[li - 1] = row_live_size_bytes;
-          row_live_count = 0;
-          row_live_size_bytes = 0;
-          wi_row_start = words_buf.size();
+    word_db::scan_words(tb.data(), 0, uint32_t(tb.size()),
+      [&](const ScannedWord& sw) {
+        auto li = sw.first_letter;
+        if (words_by_letter[li] == WordIdx::kInvalid) {
+          if (li) {
+            // null terminate
+            words_buf.emplace_back();
+            const auto row_total_count = uint32_t(words_buf.size() - wi_row_start); (void)row_total_count;
+            BNG_VERIFY(row_total_count == mem_stats.word_counts[li - 1] + 1, "");
+            live_stats.word_counts[li - 1] = row_live_count;
+            live_stats.size_bytes[li - 1] = row_live_size_bytes;
+            row_live_count = 0;
+            row_live_size_bytes = 0;
+            wi_row_start = words_buf.size();
+          }
+          // cache the start of the word list.
+          words_by_letter[li] = WordIdx(uint32_t(wi_row_start));
         }
-        // cache the start of the word list.
-        words_by_letter[li] = WordIdx(uint32_t(wi_row_start));
-      }
-      i += words_buf.emplace_back().read_str(tb, i);
+        words_buf.emplace_back(sw);
 
-      if (!words_buf.back().is_dead) {
-        row_live_size_bytes += uint32_t(words_buf.back().length);
-        ++row_live_count;
-      }
-    }
+        if (!words_buf.back().is_dead) {
+          row_live_size_bytes += uint32_t(words_buf.back().length);
+          ++row_live_count;
+        }
+        i = sw.begin + sw.span;
+      });
 
     BNG_VERIFY(i == text_buf.size(), "");
 
@@ -380,8 +394,8 @@ namespace bng::word_db_std {
     const uint32_t live_count = live_stats.total_count(); (void)live_count;
     BNG_VERIFY(
       *this &&
-      live_size < text_buf.capacity() &&
-      live_count < mem_stats.total_count(), "");
+      live_size <= text_buf.capacity() &&
+      live_count <= mem_stats.total_count(), "");
 
     WordDB out;
 
@@ -1,10 +1,18 @@
 #pragma once
 #include "core/core.h"
+#include "core/timers.h"
 #include <istream>
 #include <ostream>
+#include <string>
+#include <vector>
+
+namespace bng::word_db {
+  struct ScannedWord;
+}
 
 namespace bng::word_db_std {
   using namespace core;
+  using word_db::ScannedWord;
 
 
   class TextBuf;
@@ -74,6 +82,9 @@ namespace bng::word_db_std {
       this->begin = new_begin;
     }
 
+    // same fields read_str would produce for the word's text.
+    explicit Word(const ScannedWord& sw);
+
     size_t read_str(const std::string& buf, size_t offset);
 
     void get_letters_str(char* pout) const {
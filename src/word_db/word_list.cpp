@@ -0,0 +1,396 @@
+#include "word_db.h"
+#include "text_kernel.h"
+#include "core/parallel.h"
+#include <algorithm>
+
+namespace bng::word_db {
+  //
+  // WordDB word list ingest
+  //
+
+  namespace {
+    // words are bucketed by their first 2 letters. live words have at least 3.
+    constexpr uint32_t kPrefixBuckets = 26 * 26;
+
+    uint32_t prefix_bucket(const char* text) {
+      return uint32_t(uint8_t(text[0]) - 'a') * 26 + uint32_t(uint8_t(text[1]) - 'a');
+    }
+
+    // a word being sorted. letters kKeyBegin to kKeyEnd are cached in key, 5 bits each
+    // from the top down, so most of the sort never goes back to the text.
+    struct SortRef {
+      static constexpr uint32_t kKeyBegin = 2;
+      static constexpr uint32_t kKeyEnd = kKeyBegin + 12;
+
+      uint64_t key = 0;
+      const char* text = nullptr;
+      uint32_t length = 0;
+
+      SortRef() = default;
+
+      SortRef(const char* t, uint32_t l) : text(t), length(l) {
+        for (uint32_t i = kKeyBegin; i < kKeyEnd; ++i) {
+          key = (key << 5) | (i < length ? uint32_t(uint8_t(text[i]) - 'a') + 1 : 0);
+        }
+      }
+
+      // 1-26 for the letter at depth. 0 for a word that ends before depth, so shorter words sort first.
+      uint32_t radix_key(uint32_t depth) const {
+        if (depth - kKeyBegin < kKeyEnd - kKeyBegin) {
+          return uint32_t(key >> (5 * (kKeyEnd - 1 - depth))) & 31;
+        }
+        return depth < length ? uint32_t(uint8_t(text[depth]) - 'a') + 1 : 0;
+      }
+
+      // order of words that share their first depth letters.
+      static int compare(const SortRef& lhs, const SortRef& rhs, uint32_t depth) {
+        if (lhs.key != rhs.key) {
+          return lhs.key < rhs.key ? -1 : 1;
+        }
+        const uint32_t min_length = lhs.length < rhs.length ? lhs.length : rhs.length;
+        if (min_length <= kKeyEnd) {
+          return int(lhs.length) - int(rhs.length);
+        }
+        depth = depth > kKeyEnd ? depth : kKeyEnd;
+        const int cmp = memcmp(lhs.text + depth, rhs.text + depth, min_length - depth);
+        return cmp ? cmp : int(lhs.length) - int(rhs.length);
+      }
+    };
+
+    // runs are read back kRunBlockSize bytes at a time. they hold only live words, so a
+    // word cut off at the end of a block is always shorter than a block.
+    constexpr uint32_t kRunBlockSize = 64 * 1024;
+
+    // the live words of a sorted word list to run, one per line. false if a write fails.
+    bool write_run(const TextBuf& text, FILE* run, uint64_t& size_bytes) {
+      for (const char* p = text.begin(); *p; ) {
+        Word w;
+        const char* word_text = p;
+        p += w.read_str(word_text, word_text);
+        if (!w.is_dead) {
+          if (fwrite(word_text, 1, w.length, run) != w.length || fputc('\n', run) == EOF) {
+            return false;
+          }
+          size_bytes += w.length + 1;
+        }
+      }
+      return true;
+    }
+  } // namespace
+
+  void WordDB::load_word_lists(std::span<const std::filesystem::path> paths, uint32_t thread_count) {
+    text_buf = TextBuf();
+    fingerprint = 0;
+    thread_count = resolve_thread_count(thread_count);
+
+    if (paths.size() == 1) {
+      // a single list is sorted while processing, if it has to be.
+      text_buf = read_word_list(paths[0], thread_count);
+    }
+    else {
+      // each list is sorted as it is read and spilled to a temporary file, so at most one
+      // list's text and its sorted copy are in memory at a time. the merge then reads the
+      // runs back a block at a time, so its peak is the merged text plus a block per list.
+      auto runs = std::make_unique<File[]>(paths.size());
+      uint64_t size_bytes = 0;
+      for (uint32_t i = 0; i < uint32_t(paths.size()); ++i) {
+        auto list = read_word_list(paths[i], thread_count);
+        if (!list) {
+          return;
+        }
+        if (!is_sorted_word_list(list, thread_count)) {
+          list = sort_word_list(list, thread_count);
+        }
+        runs[i] = File::temp();
+        const bool is_spilled = runs[i] && write_run(list, runs[i], size_bytes) && !fflush(runs[i]);
+        BNG_VERIFY(is_spilled, "failed writing a temporary file for %s", paths[i].generic_string().c_str());
+        if (!is_spilled) {
+          return;
+        }
+        rewind(runs[i]);
+      }
+      text_buf = merge_word_lists(runs.get(), uint32_t(paths.size()), size_bytes);
+    }
+    if (text_buf) {
+      process_word_list(thread_count);
+    }
+  }
+
+  TextBuf WordDB::read_word_list(const std::filesystem::path& path, uint32_t thread_count) {
+    const auto pathStr = path.generic_string();
+    auto dict_file = File(pathStr.c_str(), "r");
+    if (!dict_file) {
+      return TextBuf();
+    }
+
+    auto text = TextBuf(dict_file.size_bytes());
+    const size_t read_count = fread(text.begin(), 1, text.capacity(), dict_file.fp);
+    if (!read_count) {
+      BNG_VERIFY(false, "failed reading %s", pathStr.c_str());
+      return TextBuf();
+    }
+    if (read_count < text.capacity()) {
+      memset(text.begin() + read_count, 0, text.capacity() - read_count);
+    }
+    text.set_size(read_count);
+    // the fingerprint is of the file as is, before any normalizing.
+    fingerprint = hash_bytes(text.begin(), read_count, fingerprint);
+
+    fold_case(text, thread_count);
+    return text;
+  }
+
+  void WordDB::fold_case(TextBuf& text, uint32_t thread_count) {
+    const uint64_t block_size = 1024 * 1024;
+    const auto block_count = uint32_t((text.size() + block_size - 1) / block_size);
+    parallel_for_chunks(block_count, thread_count,
+      [&](uint32_t, uint32_t bi) {
+        char* p = text.begin() + bi * block_size;
+        char* p_end = (uint64_t(text.end() - p) > block_size) ? p + block_size : text.end();
+        // 8 bytes at a time. A-Z are a-z without bit 5. adding to the low 7 bits of each byte
+        // sets its high bit if the byte is >= 'A', and again if it is > 'Z'.
+        constexpr uint64_t kOnes = 0x0101010101010101ull;
+        constexpr uint64_t kHigh = 0x8080808080808080ull;
+        for (; p_end - p >= 8; p += 8) {
+          uint64_t v;
+          memcpy(&v, p, 8);
+          const uint64_t low = v & ~kHigh;
+          const uint64_t upper = (low + (0x80 - 'A') * kOnes) & ~(low + (0x80 - 'Z' - 1) * kOnes) & ~v & kHigh;
+          v |= upper >> 2;
+          memcpy(p, &v, 8);
+        }
+        for (; p < p_end; ++p) {
+          *p = char(*p | (uint8_t(uint8_t(*p) - 'A') < 26 ? 0x20 : 0));
+        }
+      });
+  }
+
+  bool WordDB::is_sorted_word_list(const TextBuf& text, uint32_t thread_count) {
+    const uint32_t chunk_size = 64 * 1024;
+    auto chunks = std::make_unique<TextChunk[]>(text.size() / chunk_size + 1);
+    const auto chunk_count = collect_text_chunks(text, chunk_size, chunks.get());
+    parallel_for_chunks(chunk_count, thread_count,
+      [&](uint32_t, uint32_t ci) {
+        collect_live_stats(chunks[ci]);
+      });
+    return is_sorted(chunks.get(), chunk_count);
+  }
+
+  TextBuf WordDB::sort_word_list(const TextBuf& text, uint32_t thread_count) {
+    // parallel counting sort of the live words into buckets by their first 2 letters,
+    // then each bucket is radix sorted on the rest of its letters and deduplicated.
+    const uint32_t chunk_size = 64 * 1024;
+    auto chunks = std::make_unique<TextChunk[]>(text.size() / chunk_size + 1);
+    const auto chunk_count = collect_text_chunks(text, chunk_size, chunks.get());
+
+    // per chunk bucket counts, turned into each chunk's first slot in each bucket.
+    auto chunk_slots = std::make_unique<uint32_t[]>(uint64_t(chunk_count) * kPrefixBuckets);
+    parallel_for_chunks(chunk_count, thread_count,
+      [&](uint32_t, uint32_t ci) {
+        const auto& chunk = chunks[ci];
+        uint32_t* counts = chunk_slots.get() + uint64_t(ci) * kPrefixBuckets;
+        scan_words(chunk.begin, 0, uint32_t(chunk.end - chunk.begin),
+          [&](const ScannedWord& sw) {
+            if (!Word(sw).is_dead) {
+              ++counts[prefix_bucket(chunk.begin + sw.begin)];
+            }
+          });
+      });
+
+    auto bucket_begin = std::make_unique<uint32_t[]>(kPrefixBuckets + 1);
+    uint32_t ref_count = 0;
+    for (uint32_t b = 0; b < kPrefixBuckets; ++b) {
+      bucket_begin[b] = ref_count;
+      for (uint32_t ci = 0; ci < chunk_count; ++ci) {
+        auto& slot = chunk_slots[uint64_t(ci) * kPrefixBuckets + b];
+        const uint32_t count = slot;
+        slot = ref_count;
+        ref_count += count;
+      }
+    }
+    bucket_begin[kPrefixBuckets] = ref_count;
+
+    auto refs = std::make_unique<SortRef[]>(ref_count);
+    parallel_for_chunks(chunk_count, thread_count,
+      [&](uint32_t, uint32_t ci) {
+        const auto& chunk = chunks[ci];
+        uint32_t* next_slot = chunk_slots.get() + uint64_t(ci) * kPrefixBuckets;
+        scan_words(chunk.begin, 0, uint32_t(chunk.end - chunk.begin),
+          [&](const ScannedWord& sw) {
+            if (!Word(sw).is_dead) {
+              const char* word_text = chunk.begin + sw.begin;
+              refs[next_slot[prefix_bucket(word_text)]++] = SortRef(word_text, sw.length);
+            }
+          });
+      });
+    chunk_slots.reset();
+
+    // in place msd radix sort. small ranges finish with an insertion sort.
+    auto radix_sort = [](auto& self, SortRef* begin, SortRef* end, uint32_t depth) -> void {
+      if (end - begin < 32) {
+        for (SortRef* p = begin + 1; p < end; ++p) {
+          const auto ref = *p;
+          SortRef* q = p;
+          for (; q > begin && SortRef::compare(*(q - 1), ref, depth) > 0; --q) {
+            *q = *(q - 1);
+          }
+          *q = ref;
+        }
+        return;
+      }
+
+      constexpr uint32_t kKeyCount = 27;
+      uint32_t counts[kKeyCount] = {};
+      for (const SortRef* p = begin; p < end; ++p) {
+        ++counts[p->radix_key(depth)];
+      }
+      SortRef* next[kKeyCount];
+      SortRef* key_end[kKeyCount];
+      for (uint32_t k = 0, offset = 0; k < kKeyCount; ++k) {
+        next[k] = begin + offset;
+        offset += counts[k];
+        key_end[k] = begin + offset;
+      }
+      // swap each word into its key's range until every range is filled.
+      for (uint32_t k = 0; k < kKeyCount; ++k) {
+        while (next[k] < key_end[k]) {
+          const auto wk = next[k]->radix_key(depth);
+          if (wk == k) {
+            ++next[k];
+          }
+          else {
+            std::swap(*next[k], *next[wk]++);
+          }
+        }
+      }
+      // words that ended at depth are all the same word.
+      for (uint32_t k = 1; k < kKeyCount; ++k) {
+        if (counts[k] > 1) {
+          self(self, key_end[k] - counts[k], key_end[k], depth + 1);
+        }
+      }
+    };
+
+    // buckets are sorted and deduplicated in place, then written out in bucket order.
+    auto unique_counts = std::make_unique<uint32_t[]>(kPrefixBuckets);
+    auto text_begin = std::make_unique<uint64_t[]>(kPrefixBuckets + 1);
+    parallel_for_chunks(kPrefixBuckets, thread_count,
+      [&](uint32_t, uint32_t b) {
+        SortRef* begin = refs.get() + bucket_begin[b];
+        SortRef* end = refs.get() + bucket_begin[b + 1];
+        radix_sort(radix_sort, begin, end, SortRef::kKeyBegin);
+        uint32_t unique_count = 0;
+        uint64_t size_bytes = 0;
+        for (const SortRef* p = begin; p < end; ++p) {
+          if (!unique_count || SortRef::compare(begin[unique_count - 1], *p, SortRef::kKeyBegin)) {
+            begin[unique_count++] = *p;
+            size_bytes += p->length + 1;
+          }
+        }
+        unique_counts[b] = unique_count;
+        text_begin[b] = size_bytes;
+      });
+
+    uint64_t sorted_size = 0;
+    for (uint32_t b = 0; b <= kPrefixBuckets; ++b) {
+      const uint64_t size_bytes = (b < kPrefixBuckets) ? text_begin[b] : 0;
+      text_begin[b] = sorted_size;
+      sorted_size += size_bytes;
+    }
+    if (!sorted_size) {
+      return TextBuf();
+    }
+
+    auto sorted = TextBuf(sorted_size);
+    sorted.set_size(sorted_size);
+    parallel_for_chunks(kPrefixBuckets, thread_count,
+      [&](uint32_t, uint32_t b) {
+        char* out = sorted.begin() + text_begin[b];
+        const SortRef* begin = refs.get() + bucket_begin[b];
+        for (const SortRef* p = begin; p < begin + unique_counts[b]; ++p) {
+          memcpy(out, p->text, p->length);
+          out[p->length] = '\n';
+          out += p->length + 1;
+        }
+      });
+    return sorted;
+  }
+
+  TextBuf WordDB::merge_word_lists(File* runs, uint32_t run_count, uint64_t size_bytes) {
+    struct MergeCursor {
+      FILE* fp = nullptr;
+      std::unique_ptr<char[]> block;
+      const char* p = nullptr;
+      const char* p_end = nullptr;
+      WordRef word;
+
+      // moves to the next word. false at the end of the run.
+      bool next() {
+        auto eol = static_cast<const char*>(memchr(p, '\n', size_t(p_end - p)));
+        if (!eol) {
+          // the rest of the block is the start of the next word. refill after it.
+          const auto rest = size_t(p_end - p);
+          memmove(block.get(), p, rest);
+          p = block.get();
+          p_end = p + rest + fread(block.get() + rest, 1, kRunBlockSize - rest, fp);
+          eol = static_cast<const char*>(memchr(p, '\n', size_t(p_end - p)));
+          if (!eol) {
+            return false;
+          }
+        }
+        word = WordRef{ p, uint32_t(eol - p) };
+        p = eol + 1;
+        return true;
+      }
+    };
+
+    auto cursors = std::make_unique<MergeCursor[]>(run_count);
+    auto heap = std::make_unique<uint32_t[]>(run_count);
+    uint32_t heap_size = 0;
+    auto heap_greater = [&](uint32_t lhs, uint32_t rhs) {
+      return compare(cursors[lhs].word, cursors[rhs].word) > 0;
+    };
+    for (uint32_t i = 0; i < run_count; ++i) {
+      auto& cursor = cursors[i];
+      cursor.fp = runs[i];
+      cursor.block = std::make_unique<char[]>(kRunBlockSize);
+      cursor.p = cursor.p_end = cursor.block.get();
+      if (cursor.next()) {
+        heap[heap_size++] = i;
+        std::push_heap(heap.get(), heap.get() + heap_size, heap_greater);
+      }
+    }
+    if (!heap_size) {
+      return TextBuf();
+    }
+
+    // the runs' total size is the merged size before duplicates are dropped.
+    auto merged = TextBuf(size_bytes);
+    char* out = merged.begin();
+    WordRef prev;
+    while (heap_size) {
+      std::pop_heap(heap.get(), heap.get() + heap_size, heap_greater);
+      auto& cursor = cursors[heap[heap_size - 1]];
+      // runs have no duplicates of their own, so a duplicate is always the word just written.
+      if (!prev.text || compare(prev, cursor.word)) {
+        memcpy(out, cursor.word.text, cursor.word.length);
+        out[cursor.word.length] = '\n';
+        // compared against the merged copy, which a refill doesn't move.
+        prev = WordRef{ out, cursor.word.length };
+        out += cursor.word.length + 1;
+      }
+      if (cursor.next()) {
+        std::push_heap(heap.get(), heap.get() + heap_size, heap_greater);
+      }
+      else {
+        --heap_size;
+      }
+    }
+    merged.set_size(uint64_t(out - merged.begin()));
+    // set_size leaves the old capacity. the text still has to end in 2 null bytes.
+    if (merged.size() < merged.capacity()) {
+      memset(merged.end(), 0, size_t(merged.capacity() - merged.size()));
+    }
+    return merged;
+  }
+} // namespace bng::word_db
@@ -0,0 +1,16 @@
+#include "word_db_embedded.h"
+
+namespace bng::word_db {
+  namespace embedded {
+    // defined in the source word_db_gen writes at build time.
+    extern const uint64_t words_alpha_pre_size;
+    extern const uint64_t words_alpha_pre[];
+  }
+
+  WordDB embedded_word_db() {
+    // part of the executable image, so there is nothing for the checksum to catch.
+    return WordDB::view(
+      reinterpret_cast<const uint8_t*>(embedded::words_alpha_pre), embedded::words_alpha_pre_size,
+      /*verify_checksum*/false);
+  }
+} // namespace bng::word_db
@@ -0,0 +1,8 @@
+#pragma once
+#include "word_db/word_db.h"
+
+namespace bng::word_db {
+  // words_alpha.txt, preprocessed at build time and compiled into the executable.
+  // a non-owning view, so there is no file i/o and nothing to free.
+  WordDB embedded_word_db();
+}
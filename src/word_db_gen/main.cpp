@@ -0,0 +1,82 @@
+#include "core/core.h"
+#include "word_db/word_db.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace bng::core;
+using namespace bng::word_db;
+
+// build step. preprocesses one or more word lists and writes the .pre image as a
+// C++ source so it can be compiled into an executable. lists can be in any order
+// and are merged into one dictionary.
+int main(int argc, const char** argv) {
+  if (argc < 5) {
+    BNG_PUTI("usage: word_db_gen <words.txt>... <out.pre> <out.cpp> <symbol>\n"
+      "  e.g. word_db_gen words_alpha.txt words_alpha.pre words_alpha_pre.cpp words_alpha_pre\n");
+    return 1;
+  }
+  const std::vector<std::filesystem::path> txt_paths(argv + 1, argv + argc - 3);
+  const char* pre_path = argv[argc - 3];
+  const char* cpp_path = argv[argc - 2];
+  const char* symbol = argv[argc - 1];
+
+  {
+    WordDB wordDB;
+    // preprocessing uses all hardware threads.
+    if (!wordDB.load(txt_paths, 0)) {
+      // any of the lists can be the one that failed.
+      std::string txt_list;
+      for (const auto& path : txt_paths) {
+        txt_list += ' ';
+        txt_list += path.generic_string();
+      }
+      BNG_PRINT("failed loading%s\n", txt_list.c_str());
+      return 1;
+    }
+    wordDB.save(pre_path);
+  }
+
+  auto pre = File(pre_path, "rb");
+  if (!pre) {
+    BNG_PRINT("failed opening %s\n", pre_path);
+    return 1;
+  }
+  // emitted as 64 bit words, which compile much faster than the same bytes
+  // as chars. sections are 8 byte aligned so the host byte order round trips.
+  const uint64_t size = pre.size_bytes();
+  const uint64_t qword_count = (size + 7) / 8;
+  auto image = std::make_unique<uint64_t[]>(qword_count);
+  image[qword_count - 1] = 0;
+  if (fread(image.get(), 1, size, pre) != size) {
+    BNG_PRINT("failed reading %s\n", pre_path);
+    return 1;
+  }
+
+  auto cpp = File(cpp_path, "w");
+  if (!cpp) {
+    BNG_PRINT("failed opening %s\n", cpp_path);
+    return 1;
+  }
+  std::string txt_names;
+  for (const auto& path : txt_paths) {
+    txt_names += txt_names.empty() ? "" : ", ";
+    txt_names += path.filename().generic_string();
+  }
+  fprintf(cpp,
+    "// generated by word_db_gen from %s. do not edit.\n"
+    "#include <cstdint>\n\n"
+    "namespace bng::word_db::embedded {\n"
+    "  extern const uint64_t %s_size;\n"
+    "  extern const uint64_t %s[];\n\n"
+    "  const uint64_t %s_size = %lluull;\n"
+    "  // page aligned like the sections inside it.\n"
+    "  alignas(4096) const uint64_t %s[] = {\n",
+    txt_names.c_str(), symbol, symbol, symbol, (unsigned long long)size, symbol);
+  for (uint64_t i = 0; i < qword_count; ++i) {
+    fprintf(cpp, (i % 8) ? " 0x%llx," : "\n    0x%llx,", (unsigned long long)image[i]);
+  }
+  fprintf(cpp, "\n  };\n} // namespace bng::word_db::embedded\n");
+
+  return 0;
+}